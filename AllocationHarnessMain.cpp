@@ -0,0 +1,29 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "include/AllocationHarness.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*The allocation harness replaces the global operator new and delete, so it is its own executable and the study
+ * doesn't pay for the counting. Allocation_Harness [BUDGET] [--trials N] [--seed S], the budget is 0 by default.*/
+int main(int argc, char* argv[]) {
+  StudyConfiguration config;
+  double budget = 0;
+  vector<string> args(argv+1,argv+argc);
+  for(size_t i = 0;i<args.size();i++) {
+    if(args[i] == "--trials" && i+1 < args.size()) config.numTrials = stoi(args[++i]);
+    else if(args[i] == "--seed" && i+1 < args.size()) config.seed = unsigned(stoul(args[++i]));
+    else if(args[i].compare(0,2,"--") != 0) budget = stod(args[i]);
+    else {
+      cerr<<"unknown argument "<<args[i]<<endl;
+      return 2;
+    }
+  }
+  return CheckAllocations(config,budget);
+}
@@ -1,238 +1,198 @@
 #include "EstimationTPMain.h"
 
 using namespace std;
-KalmanFilter setupKalmanFilter(StateVector sensorState, TimeType Ts, VProcessNoiseGainMatrix V, double sigmaR,double sigmaTheta ) {
-  SystemMatrix F;
-  NoiseGainMatrix Gamma;
-  MeasurementMatrix H;
-  ProcessNoiseCovarianceMatrix Q;
-  MeasurementCovarianceMatrix R;
-  random_device rd;
-  mt19937 generatorX(rd()), generatorY(rd());
-  normal_distribution<double> noiseX(0,V(0,0)), noiseY(0,V(1,1));
-
-  Gamma <<
-  0.5*Ts*Ts, 0,         0,
-  Ts,        0,         0,
-  0,         0.5*Ts*Ts, 0,
-  0,         Ts,        0,
-  0,         0,         0;
-
-
-  F << 1, Ts, 0, 0, 0,
-       0, 1, 0, 0, 0,
-       0, 0, 1, Ts, 0,
-       0, 0, 0, 1, 0,
-       0, 0, 0, 0, 0;
-
-  function<SystemMatrix(StateVector)> generateSystemMatrix = [F] (StateVector x) {
-    return F;
-  };
-  function<StateVector(StateVector)> predictState = [=] (StateVector x) mutable{
-    ProcessNoiseVector sigmaV;
-    sigmaV<< noiseX(generatorX), noiseY(generatorY), 0;
-    return F*x + Gamma*sigmaV;
-  };
-  Q = Gamma*(V*V)*Gamma.transpose();//multiply V twice to get the variances
-  H << 1, 0, 0, 0, 0,
-       0, 0, 1, 0, 0;
-  R<<sigmaR*sigmaR, 0,
-     0,    sigmaTheta*sigmaTheta;
-
-  KalmanFilter myFilter(sensorState, sigmaR, sigmaTheta, Ts, generateSystemMatrix, R, H, Q,predictState);
-
-  return myFilter;
-}
-
-ExtendedKalmanFilter setupExtendedKalmanFilter(StateVector sensorState, TimeType Ts, VProcessNoiseGainMatrix V, double sigmaR,double sigmaTheta ) {
-  SystemMatrix F;
-  NoiseGainMatrix Gamma;
-  MeasurementMatrix H;
-  ProcessNoiseCovarianceMatrix Q;
-  MeasurementCovarianceMatrix R;
-  random_device rd;
-  mt19937 generatorX(rd()), generatorY(rd()), generatorOm(rd());
-  normal_distribution<double> noiseX(0,V(0,0)), noiseY(0,V(1,1)),noiseOm(0,V(2,2));
-
-  Gamma <<
-          0.5*Ts*Ts, 0,         0,
-          Ts,        0,         0,
-          0,         0.5*Ts*Ts, 0,
-          0,         Ts,        0,
-          0,         0,         Ts;
-
-
-  F <<1, Ts, 0, 0, 0,
-      0, 1, 0, 0, 0,
-      0, 0, 1, Ts, 0,
-      0, 0, 0, 1, 0,
-      0, 0, 0, 0, 1;
-  /* Calculate Jacobians - CHECKED GOOD*/
-  function<StateVector(StateVector)> calculateJacobians = [Ts] (StateVector x) {
-    StateVector j;
-    double Om = x(4), xDot = x(1), yDot = x(3);// omega, x derivative, y derivative
-    double c = cos(Om*Ts), s = sin(Om*Ts);
-    j(0) = (c*Ts*xDot/Om) - (s*xDot/(Om*Om)) - (s*Ts*yDot/Om) - ((-1+c)*yDot/(Om*Om));
-    j(1) = -s*Ts*xDot - c*Ts*yDot;
-    j(2) = (s*Ts*xDot/Om) - ((1-c)*xDot/(Om*Om)) + (c*Ts*yDot/Om) - (s*yDot/(Om*Om));
-    j(3) = c*Ts*xDot - s*Ts*yDot;
-    j(4) = 1;
-    return j;
-  };
-/*generateSystemMatrix - CHECKED GOOD*/
-  function<SystemMatrix(StateVector)> generateSystemMatrix = [=] (StateVector x) mutable {
-    double Om = x(4);//Omega
-    if(abs(Om)>.0001) {
-      double s = sin (Om*Ts), c = cos(Om*Ts);//omega, and the trig terms
-      StateVector j = calculateJacobians(x);
-      F <<1, s/Om,        0, -(1-c)/Om, j(0),
-          0, c,           0, -s,        j(1),
-          0, (1-c)/Om,    1, s/Om,      j(2),
-          0, s,           0, c,         j(3),
-          0, 0,           0, 0,         1;
-    }
-    else {
-      double xDot = x(1), yDot = x(3);
-      F << 1, Ts, 0, 0,  -0.5*Ts*Ts*yDot,
-           0, 1,  0, 0,  -Ts*yDot,
-           0, 0,  1, Ts, 0.5*Ts*Ts*xDot,
-           0, 0,  0, 1,  Ts*xDot,
-           0, 0,  0, 0,  1;
-    }
-    return F;
-  };
-  /*predictState - CHECKED GOOD*/
-  function<StateVector(StateVector)> predictState = [=] (StateVector x) mutable{
-    ProcessNoiseVector sigmaV;
-    double Om = x(4);
-    if(abs(Om)>.0001) {//don't use the limiting form!
-      double s = sin (Om*Ts), c = cos(Om*Ts);//omega, and the trig terms
-      F <<1, s/Om,     0, -(1-c)/Om, 0,
-          0, c,        0, -s,        0,
-          0, (1-c)/Om, 1, s/Om,      0,
-          0, s,        0, c,         0,
-          0, 0,        0, 0,         1;
-    }
-    sigmaV<< noiseX(generatorX), noiseY(generatorY), noiseOm(generatorOm);
-    return F*x + Gamma*sigmaV;
-  };
-  Q = Gamma*(V*V)*Gamma.transpose();//multiply V twice to get the variances
-  H << 1, 0, 0, 0, 0,
-       0, 0, 1, 0, 0;
-  R<<sigmaR*sigmaR, 0,
-     0,    sigmaTheta*sigmaTheta;//.0003046 is 1 degree squared in radians
-
-  ExtendedKalmanFilter myFilter(sensorState, sigmaR, sigmaTheta, Ts, generateSystemMatrix, R, H, Q,predictState);
-
-  return myFilter;
-}
-
 double average(vector<double> vec) {
   return accumulate(vec.begin(),vec.end(),0.0)/NUM_TRIALS;
 }
 
-int main() {
-  string dataset,filename, configID,performance, path="/home/clancy/Projects/Estimation Project 2016/Testing Data/";
-
-  filename = path + "Generated Target Trajectories/Term Project Data.txt";
+int RunCommandLine(int argc, char* argv[]) {
+  StudyConfiguration config;
+  string dataset,filename, configID,performance, path=config.path;
+  string resumeFile;
+  bool partial = false;
+  string serveSocket, replaySocket;
+  bool serve = false;
+  bool trialsGiven = false;
+  bool seedGiven = false;
+  string validatePath;
+  string sparseTrajectoryFile;
+  double stateTolerance = -1, metricTolerance = -1;
+  double precisionTolerance = -1;//--compare-precision
+
+  filename = config.trajectoryFile;
   configID = "term project";//check DataGenerator.h for correct config IDs
 
   /*Generate Data */
   /*cout << "Generating data in file " << filename<<endl;
   EstimationTPDataGenerator generator(configID,filename);*/
 
+  vector<string> args(argv+1,argv+argc);
+  auto hasValue = [&](size_t i) { return i+1 < args.size() && args[i+1].compare(0,2,"--") != 0; };
+  for(size_t i = 0;i<args.size();i++) {
+    if(args[i] == "--compare-precision") precisionTolerance = hasValue(i) ? stod(args[++i]) : 1e-3;
+    else if(args[i] == "--validate" && hasValue(i)) {//--validate PATH [STATE_TOLERANCE [METRIC_TOLERANCE]]
+      validatePath = args[++i];
+      if(hasValue(i)) stateTolerance = stod(args[++i]);
+      if(hasValue(i)) metricTolerance = stod(args[++i]);
+    }
+    else if(args[i] == "--particle-filter") {
+      config.runParticleFilter = true;
+      if(hasValue(i)) config.numParticles = stoi(args[++i]);
+    }
+    else if(args[i] == "--merge") {//--merge FILE...: sum shard checkpoints into the final results
+      vector<string> shards(args.begin()+i+1,args.end());
+      if(shards.empty()) {
+        cerr<<"--merge needs at least one checkpoint"<<endl;
+        return 2;
+      }
+      MonteCarloStudy::CheckpointConfiguration(shards[0],config);//the study is rebuilt as the shards ran it
+      MonteCarloStudy study(config);
+      for(auto& shard:shards) study.MergeCheckpoint(shard);
+      cout<<"merged "<<study.GetCompletedTrials()<<" trials from "<<shards.size()<<" shards"<<endl;
+      study.Finish();
+      return 0;
+    }
+    else if(args[i] == "--print-results" && hasValue(i)) {//metadata and a line per column of a results store
+      ResultsStore store = ResultsStore::Read(args[i+1]);
+      for(auto& entry:store.GetMetadata()) cout<<entry.first<<" = "<<entry.second<<endl;
+      for(auto& column:store.GetColumns()) {
+        auto& v = column.second;
+        cout<<column.first<<": "<<v.size()<<" rows, first "<<v.front()<<", last "<<v.back()
+            <<", mean "<<accumulate(v.begin(),v.end(),0.0)/v.size()<<endl;
+      }
+      return 0;
+    }
+    else if(args[i] == "--serve") {//real-time service on stdin/stdout, or on a Unix socket
+      serve = true;
+      if(hasValue(i)) serveSocket = args[++i];
+    }
+    else if(args[i] == "--replay" && i+1 < args.size()) replaySocket = args[++i];//socket path, or - for stdout
+    else if(args[i] == "--trial-range" && hasValue(i) && hasValue(i+1)) {//a shard: trials [BEGIN,END)
+      config.firstTrial = stoi(args[++i]);
+      config.numTrials = stoi(args[++i]) - config.firstTrial;
+      trialsGiven = true;
+    }
+    else if(args[i] == "--partial" && hasValue(i)) {//write the shard's sums to FILE instead of final results
+      config.checkpointFile = args[++i];
+      partial = true;
+    }
+    /*dense or timestamped knots, both give the truth its turn rate*/
+    else if(args[i] == "--trajectory" && hasValue(i)) config.trajectoryFile = args[++i];
+    else if(args[i] == "--sparsify-trajectory" && hasValue(i)) sparseTrajectoryFile = args[++i];//knots where the turn changes
+    else if(args[i] == "--pipelined") config.pipelined = true;
+    else if(args[i] == "--clutter") {//--clutter [FALSE_ALARMS_PER_SCAN [PD]]
+      config.clutter = true;
+      if(hasValue(i)) config.falseAlarmRate = stod(args[++i]);
+      if(hasValue(i)) config.Pd = stod(args[++i]);
+    }
+    else if(args[i] == "--miss-probability" && hasValue(i)) config.missProbability = stod(args[++i]);//per scan
+    else if(args[i] == "--distributed") {//with --sensors, [GATE] on the squared track distance
+      config.distributed = true;
+      if(hasValue(i)) config.fusionGate = stod(args[++i]);
+    }
+    else if(args[i] == "--sensors" && hasValue(i)) config.network = SensorNetwork::ReadSites(args[++i]);//x, y, sigmaR, sigmaTheta per line
+    else if(args[i] == "--trials" && hasValue(i)) {
+      config.numTrials = stoi(args[++i]);
+      trialsGiven = true;
+    }
+    else if(args[i] == "--target-rmspos" && hasValue(i)) config.targetRMSPOS = stod(args[++i]);//m, CI half-width
+    else if(args[i] == "--target-anees" && hasValue(i)) config.targetANEES = stod(args[++i]);//CI half-width
+    else if(args[i] == "--confidence" && hasValue(i)) config.confidence = stod(args[++i]);
+    else if(args[i] == "--min-trials" && hasValue(i)) config.minTrials = stoi(args[++i]);
+    else if(args[i] == "--antithetic") config.antithetic = true;
+    else if(args[i] == "--control-variates") config.controlVariates = true;
+    else if(args[i] == "--seed" && hasValue(i)) {
+      config.seed = unsigned(stoul(args[++i]));
+      seedGiven = true;
+    }
+    /*--cache DIR: results keyed by the configuration, trajectory, checkpoint format and models. Other code changes
+     * aren't seen, clear DIR after changing what a trial computes*/
+    else if(args[i] == "--cache" && hasValue(i)) config.cacheDirectory = args[++i];
+    else if(args[i] == "--checkpoint" && hasValue(i)) config.checkpointFile = args[++i];
+    else if(args[i] == "--checkpoint-every" && hasValue(i)) config.checkpointInterval = stoi(args[++i]);
+    else if(args[i] == "--resume" && hasValue(i)) resumeFile = args[++i];
+    else {
+      cerr<<"unknown argument "<<args[i]<<endl;
+      return 2;
+    }
+  }
 
+  if(config.clutter && (config.runParticleFilter || config.pipelined)) {
+    cerr<<"--clutter runs the sequential Kalman bank only, without --particle-filter or --pipelined"<<endl;
+    return 2;
+  }
+  if(!config.network.empty() && (config.clutter || config.runParticleFilter || config.pipelined)) {
+    cerr<<"--sensors runs the sequential Kalman bank only, without --clutter, --particle-filter or --pipelined"<<endl;
+    return 2;
+  }
+  if(config.missProbability > 0 && (config.clutter || !config.network.empty() || config.runParticleFilter ||
+                                    config.pipelined || config.controlVariates)) {
+    cerr<<"--miss-probability runs the sequential Kalman bank on the single sensor, without --clutter, --sensors, "
+          "--particle-filter, --pipelined or --control-variates"<<endl;
+    return 2;
+  }
+  if(config.distributed && config.network.size() < 2) {
+    cerr<<"--distributed fuses the tracks of a network, give --sensors with at least two radars"<<endl;
+    return 2;
+  }
+  if(config.Adaptive() && !trialsGiven) config.numTrials = 1000;//the budget, not a count
+  if(config.controlVariates && (config.clutter || !config.network.empty())) {
+    cerr<<"--control-variates needs the single sensor without clutter"<<endl;
+    return 2;
+  }
+  if(config.antithetic) {//pairs stay whole within a shard
+    if(config.firstTrial % 2 != 0) {
+      cerr<<"--antithetic shards must start on an even trial"<<endl;
+      return 2;
+    }
+    config.numTrials += config.numTrials % 2;
+  }
+  if(!sparseTrajectoryFile.empty()) {
+    Target(config.trajectoryFile).WriteSparse(sparseTrajectoryFile);
+    return 0;
+  }
+  if(precisionTolerance >= 0) return ComparePrecisions(config,precisionTolerance);
+  if(!validatePath.empty()) {
+    if(stateTolerance < 0) stateTolerance = 1e-2;
+    if(metricTolerance < 0) metricTolerance = stateTolerance;
+    return ValidateFastPath(config,validatePath,stateTolerance,metricTolerance);
+  }
+  if(serve) return ServeMeasurements(config,serveSocket);
+  if(!replaySocket.empty()) return ReplayMeasurements(config,replaySocket);
 
-  /*Make the sensors*/
-  StateVector sensorState;
-  sensorState << -10000,0,0,0,0;//for term project
-
-  double sigmaR = 50, sigmaTheta = .01745;
-
-  RangeSensor range(sensorState,0,sigmaR);//std dev
-  AzimuthSensor azimuth(sensorState,0,sigmaTheta);//std dev, 1 deg in radians
-
-
-  /* Make the Kalman Filter*/
-  VProcessNoiseGainMatrix V1,V2,V3;//stddev
-  TimeType Ts = 10;
-  V1 << .2, 0, 0,
-       0, .2, 0,
-       0, 0, 0;//sigma v
-  V2 << 6.0, 0, 0,
-          0, 6.0, 0,
-          0, 0, 0;//sigma v
-  V3<<1, 0, 0,
-      0, 1, 0,
-      0, 0, .005;
-
-  StateVector x;
-
-  PerformanceEvaluator peKF,peIMMCT,peIMML;
-  string performancePath = path+"Performance Data/";
-  string immLPerformancePath = performancePath+"immL/";
-  string immCTPerformancePath = performancePath+"immCT/";
-  string kfPerformancePath = performancePath+"kf/";
-
-  vector<PerformanceEvaluator*> PEs;
-  peKF.SetFilePath(kfPerformancePath);
-  peIMMCT.SetFilePath(immCTPerformancePath);
-  peIMML.SetFilePath(immLPerformancePath);
-
-  PEs.push_back(&peIMMCT);
-  PEs.push_back(&peIMML);
-  PEs.push_back(&peKF);
-
-  for(int j = 0;j<NUM_TRIALS;j++) {
-
-
-    /*Make the target*/
-    Target target(filename);//instantiate the target
-    KalmanFilter kf1 = setupKalmanFilter(sensorState, Ts, V1, sigmaR, sigmaTheta);
-    KalmanFilter kf2 = setupKalmanFilter(sensorState,Ts,V2,sigmaR,sigmaTheta);
-    ExtendedKalmanFilter ekf1 = setupExtendedKalmanFilter(sensorState, Ts, V3, sigmaR, sigmaTheta);
-    /*Get the initial  measurements*/
-    MeasurementVector z0, z1;
-    z0(0) = range.Measure(target);
-    z0(1) = azimuth.Measure(target);
-    target.Advance(10);
-    z1(0) = range.Measure(target);
-    z1(1) = azimuth.Measure(target);
-    target.Advance(10);
-
-    ofstream immCTData(path+"immCT.txt");
-    ofstream immLData(path+"immL.txt");
-    ofstream kfData(path + "kf.txt");
-    ofstream measurements(path+"measurements.txt");
-    kf1.Initialize(z0, z1);
-    ekf1.Initialize(z0, z1);
-    kf2.Initialize(z0,z1);
-    IMM immCT(kf1, ekf1);
-    IMM immL(kf1,kf2);
-    for (int i = 0; i < NUM_SAMPLES-1;i++) {
-      x = target.Sample();
-      z1(0) = range.Measure(target);
-      z1(1) = azimuth.Measure(target);
-      measurements<<z1(0)*cos(z1(1))-10000<<","<<z1(0)*sin(z1(1))<<endl;
-      immCT.Update(z1);
-      immL.Update(z1);
-      kf2.Update(z1);
-      immCTData<<immCT;
-      immLData<<immL;
-      kfData<<kf2;
-      peIMMCT.EvaluateIntermediate(immCT.GetEstimate(),immCT.GetMOD2PR(),immCT.GetRealZ(),target.Sample());
-      peIMML.EvaluateIntermediate(immL.GetEstimate(),immL.GetMOD2PR(),immL.GetRealZ(),target.Sample());
-      peKF.EvaluateIntermediate(kf2.GetEstimate(),0,kf2.GetRealZ(),target.Sample());
-      target.Advance(10);
-    }
-    for(auto pe:PEs) pe->FinishEvaluatingRun();
-    immCTData.close();
-    immLData.close();
-    kfData.close();
+  if(!config.cacheDirectory.empty()) {//the entry is resumed and checkpointed like any other checkpoint
+    if(!seedGiven || !resumeFile.empty() || !config.checkpointFile.empty()) {
+      cerr<<"--cache needs --seed and keeps its own checkpoints, without --checkpoint, --resume or --partial"<<endl;
+      return 2;
+    }
+    string entry = ResultCachePath(config);
+    int cached = ifstream(entry) ? MonteCarloStudy::CheckpointCompletedTrials(entry) : 0;
+    if(cached > config.numTrials && !config.Adaptive()) {//the sums can't be cut back, the entry is kept for later
+      cout<<"cache holds "<<cached<<" trials, more than the "<<config.numTrials<<" asked for, running without it"<<endl;
+    }
+    else {
+      if(cached > 0) resumeFile = entry;
+      config.checkpointFile = entry;
+    }
   }
-  for(auto pe:PEs) {
-    pe->CalculateFinalResults();
-    pe->WriteResultsToFile();
+  if(!resumeFile.empty() && config.checkpointFile.empty()) config.checkpointFile = resumeFile;//keep checkpointing
+  MonteCarloStudy study(config);
+  if(!resumeFile.empty()) {
+    study.LoadCheckpoint(resumeFile);
+    cout<<"resuming after trial "<<study.GetCompletedTrials()<<endl;
   }
+  study.Run();
+  if(!partial) study.Finish();
   return 0;
-}
\ No newline at end of file
+}
+
+/*A bad argument or file ends the run with its message instead of an abort*/
+int main(int argc, char* argv[]) {
+  try {
+    return RunCommandLine(argc,argv);
+  }
+  catch(const exception& e) {
+    cerr<<e.what()<<endl;
+    return 2;
+  }
+}
@@ -12,15 +12,26 @@
 #include <random>
 #include <cmath>
 #include <algorithm>
+#include <string>
+#include <vector>
 
 #include "include/EstimationTPTypeDefinitions.h"
 #include "include/KalmanFilter.h"
 #include "include/ExtendedKalmanFilter.h"
 #include "include/IMM.h"
+#include "include/MotionModels.h"
 #include "include/Target.h"
 #include "include/EstimationTPDataGenerator.h"
 #include "include/RangeSensor.h"
 #include "include/AzimuthSensor.h"
 #include "include/PerformanceEvaluator.h"
+#include "include/ParticleFilter.h"
+#include "include/StudyConfiguration.h"
+#include "include/PrecisionHarness.h"
+#include "include/ValidationHarness.h"
+#include "include/MonteCarloStudy.h"
+#include "include/TrackingService.h"
+#include "include/ResultsStore.h"
+#include "include/ResultCache.h"
 
 #endif //ESTIMATION_PROJECT_2016_ESTIMATIONTPMAIN_H
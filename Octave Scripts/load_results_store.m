@@ -0,0 +1,44 @@
+## results = load_results_store(filename)
+## Reads the single-file results store written by MonteCarloStudy::Finish. Metadata ends up as strings in
+## results.meta, every column as results.<filter>.<metric>, e.g. results.immCT.RMSPOS or results.kf.POS_p99.
+function results = load_results_store(filename)
+  if nargin < 1
+    filename = "/home/clancy/Projects/Estimation Project 2016/Testing Data/Performance Data/results.etpr";
+  endif
+  fid = fopen(filename, "r");
+  if fid < 0
+    error("could not open %s", filename);
+  endif
+  magic = fread(fid, 7, "char=>char")';
+  version = fread(fid, 1, "uint32");
+  if !strcmp(magic, "ETPRSLT") || version != 1
+    fclose(fid);
+    error("%s is not a version 1 results store", filename);
+  endif
+
+  results.meta = struct();
+  nMeta = fread(fid, 1, "uint32");
+  for i = 1:nMeta
+    key = read_string(fid);
+    results.meta.(key) = read_string(fid);
+  endfor
+
+  nColumns = fread(fid, 1, "uint32");
+  nRows = fread(fid, 1, "uint64");
+  names = cell(nColumns, 1);
+  for i = 1:nColumns
+    names{i} = read_string(fid);
+  endfor
+  data = reshape(fread(fid, nColumns*nRows, "double"), nRows, nColumns);#one read for every column
+  fclose(fid);
+
+  for i = 1:nColumns
+    parts = strsplit(names{i}, "/");
+    results.(parts{1}).(parts{2}) = data(:, i)';
+  endfor
+endfunction
+
+function s = read_string(fid)
+  n = fread(fid, 1, "uint64");
+  s = fread(fid, n, "char=>char")';
+endfunction
@@ -0,0 +1,18 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_ALLOCATIONHARNESS_H
+#define ESTIMATION_PROJECT_2016_ALLOCATIONHARNESS_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "StudyConfiguration.h"
+
+/*Counts the heap allocations of the study's hot paths, call by call: KalmanFilter::Update (kf), IMM::Update (immCT and
+ * immL) and PerformanceEvaluator::EvaluateIntermediate. The counts come from the global operator new and delete, which
+ * the harness replaces for the whole program, so Eigen's dynamic matrices (plain malloc) are not seen. The first trial
+ * warms up the evaluators' per sample storage and isn't counted. Returns nonzero when any call allocates more than the
+ * budget.*/
+int CheckAllocations(const StudyConfiguration& config, double budget);
+
+#endif //ESTIMATION_PROJECT_2016_ALLOCATIONHARNESS_H
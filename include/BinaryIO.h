@@ -0,0 +1,54 @@
+//
+// Created by clancy on 5/9/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_BINARYIO_H
+#define ESTIMATION_PROJECT_2016_BINARYIO_H
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*Raw little helpers for the checkpoint and results files. Values are written in host byte order, the files are meant
+ * to be read back on the same kind of machine.*/
+template<typename T>
+void WriteBinary(ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+template<typename T>
+T ReadBinary(istream& is) {
+  T value;
+  if(!is.read(reinterpret_cast<char*>(&value),sizeof(T))) throw runtime_error("unexpected end of binary data");
+  return value;
+}
+
+inline void WriteString(ostream& os, const string& s) {
+  WriteBinary<uint64_t>(os,s.size());
+  os.write(s.data(),s.size());
+}
+
+inline string ReadString(istream& is) {
+  string s(ReadBinary<uint64_t>(is),'\0');
+  if(!is.read(&s[0],s.size())) throw runtime_error("unexpected end of binary data");
+  return s;
+}
+
+inline void WriteVector(ostream& os, const vector<double>& v) {
+  WriteBinary<uint64_t>(os,v.size());
+  os.write(reinterpret_cast<const char*>(v.data()),v.size()*sizeof(double));
+}
+
+inline vector<double> ReadVector(istream& is) {
+  vector<double> v(ReadBinary<uint64_t>(is));
+  if(!is.read(reinterpret_cast<char*>(v.data()),v.size()*sizeof(double))) {
+    throw runtime_error("unexpected end of binary data");
+  }
+  return v;
+}
+
+#endif //ESTIMATION_PROJECT_2016_BINARYIO_H
@@ -0,0 +1,46 @@
+//
+// Created by clancy on 5/14/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_CLUTTERSENSOR_H
+#define ESTIMATION_PROJECT_2016_CLUTTERSENSOR_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "RangeSensor.h"
+#include "AzimuthSensor.h"
+#include "Target.h"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/*Wraps the range and azimuth sensors into a scanning sensor: the target is detected with probability Pd, and a
+ * Poisson number of false alarms is spread uniformly in range and azimuth over the surveillance region. Returns come
+ * back in random order, so nothing downstream can tell which one is the target.*/
+class ClutterSensor {
+  RangeSensor& _range;
+  AzimuthSensor& _azimuth;
+  double _Pd, _falseAlarmRate;//detection probability, mean false alarms per scan
+  double _rMin, _rMax, _thetaMin, _thetaMax;//surveillance region
+  mt19937 _generator;
+  bool _detected = false;
+
+  public:
+  ClutterSensor(RangeSensor& range,
+                AzimuthSensor& azimuth,
+                double Pd,
+                double falseAlarmRate,
+                double rMin,
+                double rMax,
+                double thetaMin,
+                double thetaMax);
+
+  void Seed(unsigned seed);
+  void Scan(Target& aTarget, vector<MeasurementVector>& returns);//returns is reused from scan to scan
+  double GetClutterDensity();//false alarms per scan per m per rad, for PDAParameters
+  bool TargetDetected();//whether the last scan held a target return, for diagnostics only
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_CLUTTERSENSOR_H
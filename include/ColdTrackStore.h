@@ -0,0 +1,44 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_COLDTRACKSTORE_H
+#define ESTIMATION_PROJECT_2016_COLDTRACKSTORE_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "IMM.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/*Dormant tracks of one bank, packed: per track every model's x at the state precision, and the mode probabilities and
+ * every model's upper triangle of P at ColdScalar (float halves it), in two flat arrays. The models are the bank's,
+ * checked by fingerprint, so a track holds no model, scratch or noise stream. A track is thawed into a hot IMM built
+ * like the prototype (a small pool of them) for its update and frozen back.*/
+template<class PrecisionPolicy = DoublePrecision, class ColdScalar = typename CommonTypes<PrecisionPolicy>::CovarianceScalar>
+class ColdTrackStore {
+  public:
+  typedef typename IMM<PrecisionPolicy>::StateScalar StateScalar;
+
+  private:
+  uint64_t _models;//the prototype's model fingerprint
+  size_t _stateStride, _covarianceStride;
+  vector<StateScalar> _x;
+  vector<ColdScalar> _P;
+
+  void Check(const IMM<PrecisionPolicy>& track) const;
+
+  public:
+  ColdTrackStore(const IMM<PrecisionPolicy>& prototype);
+
+  size_t Freeze(const IMM<PrecisionPolicy>& track);//a new dormant track, returns its index
+  void Freeze(const IMM<PrecisionPolicy>& track, size_t index);
+  void Thaw(size_t index, IMM<PrecisionPolicy>& track) const;
+  void Remove(size_t index);//the last track takes its index
+  size_t Size() const;
+  size_t BytesPerTrack() const;
+};
+
+#endif //ESTIMATION_PROJECT_2016_COLDTRACKSTORE_H
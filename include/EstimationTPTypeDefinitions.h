@@ -13,6 +13,12 @@ using namespace Eigen;
 #define  NUM_STATES  5
 #define  NUM_MEASUREMENTS  2
 #define  NUM_PROCESS_NOISES  3
+#define  CV_STATES  4 //x, xDot, y, yDot
+#define  CT_STATES  5 //x, xDot, y, yDot, omega
+#define  CA_STATES  6 //x, xDot, y, yDot, xDDot, yDDot
+#define  CV_PROCESS_NOISES  2
+#define  CT_PROCESS_NOISES  3
+#define  CA_PROCESS_NOISES  2
 #define NUM_TRIALS 5.0
 #define NUM_STEPS 50
 #define NUM_SAMPLES 48.0
@@ -36,6 +42,50 @@ typedef Matrix<DataType, NUM_FILTERS,NUM_FILTERS> MixProbabilityMatrix;
 typedef Matrix<DataType, NUM_FILTERS,1> ModeProbabilityVector;
 typedef Matrix<DataType, NUM_FILTERS,1> LikelihoodVector;
 
+/*Scalar policy for the filter stack. State is used for x, the gain and the residual, Covariance for the Riccati
+ * recursion (P, F, Q, R, S) and the mode probabilities. Configuration and evaluation always stay in DataType.*/
+template<typename StateScalar, typename CovarianceScalar = StateScalar>
+struct Precision {
+  typedef StateScalar State;
+  typedef CovarianceScalar Covariance;
+};
+typedef Precision<double> DoublePrecision;
+typedef Precision<float> SinglePrecision;
+typedef Precision<float,double> MixedPrecision;//float state and gain, double covariance update
+
+/*The typedefs above describe the common (evaluation) state space that the target, the sensors and the IMM output
+ * live in. Each filter model is dimensioned by its own state, measurement and process noise counts.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy = DoublePrecision>
+struct FilterTypes {
+  typedef typename PrecisionPolicy::State StateScalar;
+  typedef typename PrecisionPolicy::Covariance CovarianceScalar;
+  typedef Matrix<StateScalar, NStates,1> StateVector;
+  typedef Matrix<StateScalar, NMeasurements,1> MeasurementVector;
+  typedef Matrix<StateScalar, NStates,NStates> PropagationMatrix;//F as applied to the state
+  typedef Matrix<CovarianceScalar, NStates,NStates> SystemMatrix;
+  typedef Matrix<CovarianceScalar, NStates,NStates> StateCovarianceMatrix;
+  typedef Matrix<CovarianceScalar, NStates,NStates> ProcessNoiseCovarianceMatrix;
+  typedef Matrix<CovarianceScalar, NMeasurements,NStates> MeasurementMatrix;
+  typedef Matrix<CovarianceScalar, NMeasurements,NMeasurements> MeasurementCovarianceMatrix;
+  typedef Matrix<StateScalar, NStates, NMeasurements> GainMatrix;
+  typedef Matrix<StateScalar, NStates,NProcessNoises> NoiseGainMatrix;
+  typedef Matrix<DataType, NProcessNoises,NProcessNoises> VProcessNoiseGainMatrix;
+  typedef Matrix<StateScalar, NProcessNoises,1> ProcessNoiseVector;
+};
+
+/*The common state space at a given precision, used for IMM mixing*/
+template<class PrecisionPolicy>
+struct CommonTypes {
+  typedef typename PrecisionPolicy::State StateScalar;
+  typedef typename PrecisionPolicy::Covariance CovarianceScalar;
+  typedef Matrix<StateScalar, NUM_STATES,1> StateVector;
+  typedef Matrix<CovarianceScalar, NUM_STATES,NUM_STATES> StateCovarianceMatrix;
+  typedef Matrix<CovarianceScalar, NUM_FILTERS, NUM_FILTERS> TransitionMatrix;
+  typedef Matrix<CovarianceScalar, NUM_FILTERS,NUM_FILTERS> MixProbabilityMatrix;
+  typedef Matrix<CovarianceScalar, NUM_FILTERS,1> ModeProbabilityVector;
+  typedef Matrix<CovarianceScalar, NUM_FILTERS,1> LikelihoodVector;
+};
+
 
 
 #endif //ESTIMATION_PROJECT_2016_ESTIMATIONTPTYPEDEFINITIONS_H
@@ -7,21 +7,21 @@
 
 #include "KalmanFilter.h"
 
-class ExtendedKalmanFilter : public KalmanFilter {
+template<int NStates,
+         int NMeasurements = NUM_MEASUREMENTS,
+         int NProcessNoises = NUM_PROCESS_NOISES,
+         class PrecisionPolicy = DoublePrecision>
+class ExtendedKalmanFilter : public KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy> {
+  typedef KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy> Base;
+
   public:
   ExtendedKalmanFilter();
-  ExtendedKalmanFilter(StateVector sensorState,
-                      double sigmaR,
-                      double sigmaTheta,
-                      TimeType Ts,
-                      function<SystemMatrix(StateVector)> generateSystemMatrix,
-                      MeasurementCovarianceMatrix R,
-                      MeasurementMatrix H,
-                      ProcessNoiseCovarianceMatrix Q,
-                      function<StateVector(StateVector)> predictState);
-
+  ExtendedKalmanFilter(shared_ptr<const typename Base::Model> model, unsigned seed);
 
+  virtual unique_ptr<ModeFilter<PrecisionPolicy>> Clone() const;
 };
 
+template<class PrecisionPolicy = DoublePrecision>
+using CTExtendedKalmanFilter = ExtendedKalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, PrecisionPolicy>;
 
 #endif //ESTIMATION_PROJECT_2016_EXTENDEDKALMANFILTER_H
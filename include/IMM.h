@@ -6,33 +6,90 @@
 #define ESTIMATION_PROJECT_2016_IMM_H
 
 #include "EstimationTPTypeDefinitions.h"
-#include "KalmanFilter.h"
+#include "ModeFilter.h"
 
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <memory>
+#include <vector>
+
+template<class PrecisionPolicy = DoublePrecision>
 class IMM {
-  StateVector _x;
-  StateCovarianceMatrix _P;
-  TransitionMatrix _p;
-  MixProbabilityMatrix _muMix;
-  vector<KalmanFilter> _filters;
-  ModeProbabilityVector _muMode, _c;
-  vector<pair<StateVector, StateCovarianceMatrix>> _mixed;
-  LikelihoodVector _Lambda;
-
-  void CalculateMixingProbabilities();
-  void CalculateNormalizingConstants();
+  public:
+  typedef CommonTypes<PrecisionPolicy> Types;
+  typedef typename Types::StateScalar StateScalar;
+  typedef typename Types::CovarianceScalar CovarianceScalar;
+  typedef typename Types::StateVector IMMStateVector;
+  typedef typename Types::StateCovarianceMatrix IMMStateCovarianceMatrix;
+  typedef pair<IMMStateVector,IMMStateCovarianceMatrix> IMMEstimate;
+
+  private:
+  IMMStateVector _x;
+  IMMStateCovarianceMatrix _P;
+  typename Types::TransitionMatrix _p;
+  typename Types::MixProbabilityMatrix _muMix;
+  vector<unique_ptr<ModeFilter<PrecisionPolicy>>> _filters;//the models may differ in state dimension, mixing is done in the common state
+  typename Types::ModeProbabilityVector _muMode, _c, _initialMuMode;
+  vector<IMMEstimate> _mixed, _estimates;
+  typename Types::LikelihoodVector _Lambda;
+  map<int,typename Types::TransitionMatrix> _transitionPowers;//p^k by gap length, for coasting
+
+  void CalculateMixingProbabilities(const typename Types::TransitionMatrix& p);
+  void CalculateNormalizingConstants(const typename Types::TransitionMatrix& p);
+  const typename Types::TransitionMatrix& TransitionPower(int k);
   void Mix();
   void MixStateEstimates();
   void MixStateCovarianceEstimates();
-  void GetLikelihoods(MeasurementVector z);
+  void GetLikelihoods(const ConvertedMeasurement& z);
+  void GetLikelihoods(const ConvertedScan& scan, const PDAParameters& pda);
   void UpdateModeProbabilities();
   void Estimate();
+  template<class ColdScalar> void FreezeTrack(StateScalar* x, ColdScalar* P) const;
+  template<class ColdScalar> void ThawTrack(const StateScalar* x, const ColdScalar* P);
   public:
-  IMM(KalmanFilter f1, KalmanFilter f2);
+  IMM(const ModeFilter<PrecisionPolicy>& f1, const ModeFilter<PrecisionPolicy>& f2);
+  IMM(const IMM& other);
+  IMM& operator=(const IMM& other);
+
+  /*A pooled IMM is reused from run to run: Reset reseeds every model in place (a seed each, in construction order)
+   * and restores the initial mode probabilities, then Initialize starts every model from the same two measurements*/
+  void Reset(initializer_list<unsigned> seeds, bool antithetic = false);
+  void Initialize(const ConvertedMeasurement& z0, const ConvertedMeasurement& z1);
 
-  pair<StateVector,StateCovarianceMatrix> Update(MeasurementVector z);
-  pair<StateVector,StateCovarianceMatrix> GetEstimate();
+  IMMEstimate Update(MeasurementVector z);
+  IMMEstimate Update(const ConvertedMeasurement& z);
+  IMMEstimate UpdatePDA(const ConvertedScan& scan, const PDAParameters& pda);//IMM-PDA, every model associates on its own
+  /*k scans without a detection. The models are mixed once with the k step transition p^k and then each coasts over
+   * the whole gap, so a mode switch is taken to happen at the start of the gap. For k = 1 that is exactly the IMM cycle
+   * with equal likelihoods.*/
+  IMMEstimate Coast(int k);
+  IMMEstimate GetEstimate();
   MeasurementVector GetRealZ();
 
+  /*A track's whole state: the mode probabilities and every model's track. Loading it into an IMM built from the same
+   * configuration (a pooled one, say) continues the track, the combined estimate is rebuilt from the models*/
+  void SaveState(ostream& os) const;
+  void LoadState(istream& is);
+
+  /*Versioned bulk snapshot, for moving tracks between processes. Layout, host byte order:
+   *   "ETPSNAP", uint32 version, uint8 state and covariance scalar sizes, uint32 track count, then every track's
+   *   SaveState
+   * A double precision immCT track takes 345 bytes. ReadSnapshot loads into the IMMs already in tracks, which is
+   * cheap, and copies the prototype for any more, which clones its models.*/
+  static void WriteSnapshot(ostream& os, const vector<IMM>& tracks);
+  static void ReadSnapshot(istream& is, vector<IMM>& tracks, const IMM& prototype);
+
+  /*The cold form of a dormant track, for ColdTrackStore: every model's x to x, the mode probabilities and every
+   * model's packed P to P. ModelFingerprint identifies the model set, a track only thaws into an IMM on the same one.*/
+  int ColdStateSize() const;
+  int ColdCovarianceSize() const;
+  uint64_t ModelFingerprint() const;
+  void Freeze(StateScalar* x, float* P) const;
+  void Freeze(StateScalar* x, double* P) const;
+  void Thaw(const StateScalar* x, const float* P);
+  void Thaw(const StateScalar* x, const double* P);
+
   double GetNORXE(StateVector x);
   double GetFPOS();
   double GetFVEL();
@@ -42,7 +99,15 @@ class IMM {
   double GetSCRS(StateVector x);
   double GetNEES(StateVector x);
   double GetMOD2PR();
-  friend ofstream& operator<<(ofstream& of,const IMM& imm);
+
+  friend ofstream& operator<<(ofstream& of,const IMM& imm) {
+    IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");//Formatting for outputting Eigen matrix
+    //of << "t = "<<filter._t<<endl;
+    of <<imm._x.format(myFormat)<<endl;
+    //of << "P = "<<filter._P.format(OctaveFmt)<<endl;
+    //of << "W = "<<filter._W.format(OctaveFmt)<<endl;
+    return of;
+  }
 };
 
 
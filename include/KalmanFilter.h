@@ -6,60 +6,157 @@
 #define ESTIMATION_PROJECT_2016_KALMANFILTER_H
 
 #include "EstimationTPTypeDefinitions.h"
+#include "ModeFilter.h"
 
+#include <array>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 #include <functional>
 #include <fstream>
+#include <stdexcept>
 #include <random>
 
 using namespace std;
 
-class KalmanFilter {
+/*What a model promises about its system matrix, so the predicted covariance can skip the structural zeros. Every
+ * kernel computes F*P*F' exactly, it only leaves out products with entries the structure says are zero.*/
+enum class CovarianceStructure {
+  Dense,//no promise
+  AxisBlocks,//F = diag(Fx, Fy) on (x, xDot) and (y, yDot): the CV model
+  TurnRateColumn//F = [A b; 0 1] with unit position columns in A, omega only enters through b: the CT EKF
+};
+
+/*Everything that defines a model and that no run changes. It is immutable once built and shared by reference: every
+ * filter set up from the same configuration points at one block (the setup functions in MotionModels cache them), so
+ * a filter itself only carries its estimate, its scratch and its noise streams.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+struct KalmanModel {
+  typedef FilterTypes<NStates,NMeasurements,NProcessNoises,PrecisionPolicy> Types;
+
+  MeasurementConverter converter;
+  TimeType Ts;//sampling time
+  typename Types::MeasurementMatrix H;
+  typename Types::ProcessNoiseCovarianceMatrix Q;
+  typename Types::MeasurementCovarianceMatrix initialR;//until the first measurement brings its own
+  function<typename Types::StateVector(typename Types::StateVector,typename Types::ProcessNoiseVector)> predictState;//x and the process noise draw
+  function<typename Types::SystemMatrix(typename Types::StateVector)> generateSystemMatrix;
+  Matrix<DataType,NProcessNoises,1> processNoiseStdDev;
+  CovarianceStructure structure;
+  uint64_t fingerprint = 0;//of everything the model is built from, set by the setup functions; snapshots check it
+  bool linear = false;//F doesn't depend on the state, coasting can then jump over a gap
+  Matrix<DataType,NStates,NStates> F;//a linear model's system matrix
+
+  KalmanModel() = default;
+  KalmanModel(const KalmanModel& other);//a variant of a model, e.g. on other kernels; the coast transitions aren't copied
+
+  /*F^k and the process noise accumulated over k steps, the sum of F^i Q F^i' for i < k. Built by squaring on first use
+   * and kept for the model's lifetime, so every filter sharing the model coasts any gap it has seen before in O(1)*/
+  typedef pair<Matrix<DataType,NStates,NStates>,Matrix<DataType,NStates,NStates>> Transition;
+  const Transition& CoastTransition(int k) const;
+
+  private:
+  mutable mutex _transitionMutex;
+  mutable map<int,Transition> _transitions;
+  const Transition& CoastTransitionLocked(int k) const;
+};
+
+template<int NStates,
+         int NMeasurements = NUM_MEASUREMENTS,
+         int NProcessNoises = NUM_PROCESS_NOISES,
+         class PrecisionPolicy = DoublePrecision>
+class KalmanFilter : public ModeFilter<PrecisionPolicy> {
+  static_assert(NMeasurements == NUM_MEASUREMENTS, "measurements are converted from a single range/azimuth pair");
+
+  public:
+  typedef FilterTypes<NStates,NMeasurements,NProcessNoises,PrecisionPolicy> Types;
+  typedef typename Types::StateScalar StateScalar;
+  typedef typename Types::CovarianceScalar CovarianceScalar;
+  typedef typename Types::StateVector ModelStateVector;
+  typedef typename Types::MeasurementVector ModelMeasurementVector;
+  typedef typename Types::StateCovarianceMatrix ModelStateCovarianceMatrix;
+  typedef typename Types::PropagationMatrix ModelPropagationMatrix;
+  typedef typename Types::SystemMatrix ModelSystemMatrix;
+  typedef typename Types::ProcessNoiseCovarianceMatrix ModelProcessNoiseCovarianceMatrix;
+  typedef typename Types::MeasurementMatrix ModelMeasurementMatrix;
+  typedef typename Types::MeasurementCovarianceMatrix ModelMeasurementCovarianceMatrix;
+  typedef typename Types::GainMatrix ModelGainMatrix;
+  typedef typename Types::NoiseGainMatrix ModelNoiseGainMatrix;
+  typedef typename Types::VProcessNoiseGainMatrix ModelVProcessNoiseGainMatrix;
+  typedef typename Types::ProcessNoiseVector ModelProcessNoiseVector;
+  typedef Matrix<DataType,NProcessNoises,1> ProcessNoiseStdDevVector;
+  typedef typename ModeFilter<PrecisionPolicy>::CommonEstimate CommonEstimate;
+  typedef KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy> Model;
+
   protected:
-  StateVector _sensorState;
-  double _validityConstant,_sigmaR, _sigmaTheta;
-  TimeType _Ts;//sampling time
+  shared_ptr<const Model> _model;
   volatile int _t = 0;//actual time in units in which the system advances
 
-  StateVector _x;//state estimate
-  MeasurementVector _z,_zReal,_v;// measurement estimate,real measurement, and residual
-  StateCovarianceMatrix _P;//covariance matrix
-  GainMatrix _W;//gain matrix
-  SystemMatrix _F;//system matrix
-  ProcessNoiseVector _processNoise;
-  ProcessNoiseCovarianceMatrix _Q;//noise covariance
-  MeasurementCovarianceMatrix _R,_initialR;//measurement covariance
-  MeasurementMatrix _H;//measurement matrix
-  MeasurementCovarianceMatrix _S;//measurement prediction covariance
-  function<StateVector(StateVector)> _predictState;
-  function<SystemMatrix(StateVector)> _generateSystemMatrix;
-
-  void UpdateStateEstimate(MeasurementVector z);
+  ModelStateVector _x;//state estimate
+  ModelMeasurementVector _z,_v;// measurement estimate and residual
+  MeasurementVector _zReal;//real measurement, converted
+  ModelStateCovarianceMatrix _P;//covariance matrix
+  ModelGainMatrix _W;//gain matrix
+  ModelSystemMatrix _F;//system matrix
+  ModelProcessNoiseVector _processNoise;//this step's draw
+  array<mt19937,NProcessNoises> _noiseGenerators;//a stream per process noise, seeded in order from one seed
+  array<normal_distribution<double>,NProcessNoises> _noise;
+  bool _antithetic = false;//mirror the draws, they are zero mean
+  ModelMeasurementCovarianceMatrix _R;//measurement covariance
+  ModelMeasurementCovarianceMatrix _S;//measurement prediction covariance
+  double _pdaLikelihood = -1;//set by UpdatePDA, negative after a plain update
+
+  void UpdateStateEstimate(ModelMeasurementVector z);
   void UpdateCovarianceAndGain();
-  MeasurementVector ConvertToCartesian(MeasurementVector z);
+  void PropagateCovariance();//_P = _F*_P*_F'+Q
+  void DrawProcessNoise();
+  template<class ColdScalar> void FreezeTrack(StateScalar* x, ColdScalar* P) const;
+  template<class ColdScalar> void ThawTrack(const StateScalar* x, const ColdScalar* P);
 
   public:
   KalmanFilter();
-  KalmanFilter(StateVector sensorState,
-              double sigmaR,
-              double sigmaTheta,
-              TimeType Ts,
-              function<SystemMatrix(StateVector)> generateSystemMatrix,
-              MeasurementCovarianceMatrix R,
-              MeasurementMatrix H,
-              ProcessNoiseCovarianceMatrix Q,
-              function<StateVector(StateVector)> predictState);
-
-  virtual pair<StateVector,StateCovarianceMatrix> Update(MeasurementVector measurement);
+  KalmanFilter(shared_ptr<const Model> model, unsigned seed);
+
+  virtual CommonEstimate Update(MeasurementVector measurement);
+  virtual CommonEstimate Update(const ConvertedMeasurement& measurement);
+  const MeasurementConverter& GetConverter() const;
+  const shared_ptr<const Model>& GetModel() const;
+  virtual CommonEstimate UpdatePDA(const ConvertedScan& scan, const PDAParameters& pda);
+  virtual CommonEstimate Coast(int k);
   void Initialize(MeasurementVector z0,MeasurementVector z1);
-  pair<StateVector,StateCovarianceMatrix> GetEstimate();
-  void Reinitialize(pair<StateVector,StateCovarianceMatrix> params);
+  virtual void Initialize(const ConvertedMeasurement& z0, const ConvertedMeasurement& z1);//e.g. fused network scans
+  virtual void Reset(unsigned seed, bool antithetic = false);
+  CommonEstimate GetEstimate();
+  pair<ModelStateVector,ModelStateCovarianceMatrix> GetModelEstimate();
+  void Reinitialize(CommonEstimate params);
+  void ReinitializeModel(pair<ModelStateVector,ModelStateCovarianceMatrix> params);
   double GetLikelihood();
   MeasurementVector GetRealZ();
-  friend ofstream& operator<<(ofstream& of,const KalmanFilter& kf);
+  virtual unique_ptr<ModeFilter<PrecisionPolicy>> Clone() const;
+  virtual void SaveState(ostream& os) const;
+  virtual void LoadState(istream& is);
+  virtual int NumStates() const;
+  virtual uint64_t ModelFingerprint() const;
+  virtual void Freeze(StateScalar* x, float* P) const;
+  virtual void Freeze(StateScalar* x, double* P) const;
+  virtual void Thaw(const StateScalar* x, const float* P);
+  virtual void Thaw(const StateScalar* x, const double* P);
 
+  friend ofstream& operator<<(ofstream& of,const KalmanFilter& filter) {
+    IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");//Formatting for outputting Eigen matrix
+    of <<EmbedState<NStates>(filter._x,filter._P).first.format(myFormat)<<endl;//always written in the common state
+    return of;
+  }
 };
 
+template<class PrecisionPolicy = DoublePrecision>
+using CVKalmanFilter = KalmanFilter<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, PrecisionPolicy>;
+template<class PrecisionPolicy = DoublePrecision>
+using CTKalmanFilter = KalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, PrecisionPolicy>;
+template<class PrecisionPolicy = DoublePrecision>
+using CAKalmanFilter = KalmanFilter<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, PrecisionPolicy>;
+
 #endif //ESTIMATION_PROJECT_2016_KALMANFILTER_H
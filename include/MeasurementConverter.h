@@ -0,0 +1,52 @@
+//
+// Created by clancy on 5/13/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_MEASUREMENTCONVERTER_H
+#define ESTIMATION_PROJECT_2016_MEASUREMENTCONVERTER_H
+
+#include "EstimationTPTypeDefinitions.h"
+
+#include <vector>
+
+using namespace std;
+
+/*A range/azimuth measurement converted to Cartesian, with the covariance of the converted position*/
+struct ConvertedMeasurement {
+  MeasurementVector polar;//as measured
+  MeasurementVector z;
+  MeasurementCovarianceMatrix R;
+};
+
+/*Every return of a cluttered scan, converted in one batch and shared by the bank*/
+struct ConvertedScan {
+  vector<MeasurementVector> polar;
+  Array<DataType,Dynamic,1> x, y, Rxx, Ryy, Rxy;
+};
+
+/*Polar to Cartesian conversion with debiasing for one sensor. Everything that only depends on the sensor is computed
+ * once here, so a measurement is converted once and shared by every filter that consumes it.*/
+class MeasurementConverter {
+  typedef Array<DataType,Dynamic,1> Column;
+
+  StateVector _sensorState;
+  double _sigmaR, _sigmaTheta;
+  double _validityConstant;//debias when r*_validityConstant > 0.4
+  double _b1, _b2;//bias compensation factors
+
+  public:
+  MeasurementConverter();
+  MeasurementConverter(StateVector sensorState, double sigmaR, double sigmaTheta);
+
+  ConvertedMeasurement Convert(MeasurementVector z) const;
+  MeasurementVector ToPolar(MeasurementVector z) const;//a Cartesian position as the sensor would see it
+  /*Whole measurement streams, structure of arrays. The double angle terms come from identities, so results can
+   * differ from Convert in the last bits*/
+  void ConvertBatch(const Column& r, const Column& theta,
+                    Column& x, Column& y, Column& Rxx, Column& Ryy, Column& Rxy) const;
+  vector<ConvertedMeasurement> ConvertBatch(const vector<MeasurementVector>& z) const;
+  void ConvertScan(const vector<MeasurementVector>& z, ConvertedScan& scan) const;//reuses the scan's storage
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_MEASUREMENTCONVERTER_H
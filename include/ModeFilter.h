@@ -0,0 +1,123 @@
+//
+// Created by clancy on 5/2/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_MODEFILTER_H
+#define ESTIMATION_PROJECT_2016_MODEFILTER_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "MeasurementConverter.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+using namespace std;
+
+/*Maps every model state onto the common state (x, xDot, y, yDot, omega). A common index of -1 marks a state that only
+ * the model carries; it is kept from the model's own estimate when the IMM reinitializes the filter. Common states the
+ * model does not carry are embedded as 0 with zero variance, which is exactly what the old 5 state CV model produced.*/
+template<int NStates>
+struct StateEmbedding;
+
+template<>
+struct StateEmbedding<CV_STATES> {
+  static int CommonIndex(int i) { return i; }
+};
+
+template<>
+struct StateEmbedding<CT_STATES> {
+  static int CommonIndex(int i) { return i; }
+};
+
+template<>
+struct StateEmbedding<CA_STATES> {
+  static int CommonIndex(int i) { return i < 4 ? i : -1; }//the accelerations are private to the model
+};
+
+template<int NStates, typename StateScalar, typename CovarianceScalar>
+pair<Matrix<StateScalar,NUM_STATES,1>,Matrix<CovarianceScalar,NUM_STATES,NUM_STATES>>
+EmbedState(const Matrix<StateScalar,NStates,1>& x, const Matrix<CovarianceScalar,NStates,NStates>& P) {
+  Matrix<StateScalar,NUM_STATES,1> xCommon = Matrix<StateScalar,NUM_STATES,1>::Zero();
+  Matrix<CovarianceScalar,NUM_STATES,NUM_STATES> PCommon = Matrix<CovarianceScalar,NUM_STATES,NUM_STATES>::Zero();
+  for(int i = 0;i<NStates;i++) {
+    int ci = StateEmbedding<NStates>::CommonIndex(i);
+    if(ci < 0) continue;
+    xCommon(ci) = x(i);
+    for(int j = 0;j<NStates;j++) {
+      int cj = StateEmbedding<NStates>::CommonIndex(j);
+      if(cj >= 0) PCommon(ci,cj) = P(i,j);
+    }
+  }
+  return make_pair(xCommon,PCommon);
+}
+
+/*Overwrites the shared part of the model state with the common estimate. Private states keep their own value and
+ * variance, their correlation with the replaced states is dropped so that P stays positive semi-definite.*/
+template<int NStates, typename StateScalar, typename CovarianceScalar>
+void ProjectState(const pair<Matrix<StateScalar,NUM_STATES,1>,Matrix<CovarianceScalar,NUM_STATES,NUM_STATES>>& common,
+                  Matrix<StateScalar,NStates,1>& x,
+                  Matrix<CovarianceScalar,NStates,NStates>& P) {
+  for(int i = 0;i<NStates;i++) {
+    int ci = StateEmbedding<NStates>::CommonIndex(i);
+    if(ci >= 0) x(i) = common.first(ci);
+    for(int j = 0;j<NStates;j++) {
+      int cj = StateEmbedding<NStates>::CommonIndex(j);
+      if(ci >= 0 && cj >= 0) P(i,j) = common.second(ci,cj);
+      else if((ci < 0) != (cj < 0)) P(i,j) = 0;
+    }
+  }
+}
+
+/*Probabilistic data association in clutter. The clutter is uniform in range and azimuth, so its density in the
+ * converted Cartesian measurement space is clutterDensity/r at range r.*/
+struct PDAParameters {
+  double Pd = .9;//detection probability
+  double Pg = .99;//gate probability
+  double clutterDensity = 0;//false alarms per scan per m of range per rad of azimuth
+
+  double Gamma() const { return -2*log(1-Pg); }//chi-square gate for two measurement dimensions
+};
+
+/*What the IMM needs from a mode-matched filter, independent of the model's state dimension.
+ * Estimates cross this interface in the common state space at the filter's precision; measurements always arrive
+ * as the sensors produce them.*/
+template<class PrecisionPolicy = DoublePrecision>
+class ModeFilter {
+  public:
+  typedef typename CommonTypes<PrecisionPolicy>::StateVector CommonStateVector;
+  typedef typename CommonTypes<PrecisionPolicy>::StateCovarianceMatrix CommonStateCovarianceMatrix;
+  typedef pair<CommonStateVector,CommonStateCovarianceMatrix> CommonEstimate;
+  typedef typename CommonTypes<PrecisionPolicy>::StateScalar StateScalar;
+
+  virtual ~ModeFilter() { }
+
+  virtual CommonEstimate Update(MeasurementVector measurement) = 0;
+  virtual CommonEstimate Update(const ConvertedMeasurement& measurement) = 0;//converted once, shared by the bank
+  virtual const MeasurementConverter& GetConverter() const = 0;
+  virtual CommonEstimate UpdatePDA(const ConvertedScan& scan, const PDAParameters& pda) = 0;
+  virtual CommonEstimate Coast(int k) = 0;//predict over k scans without a detection, no process noise is drawn
+  virtual CommonEstimate GetEstimate() = 0;
+  virtual void Reinitialize(CommonEstimate params) = 0;
+  virtual void Initialize(const ConvertedMeasurement& z0, const ConvertedMeasurement& z1) = 0;
+  virtual void Reset(unsigned seed, bool antithetic = false) = 0;//as constructed with this seed, before Initialize, without allocating
+  virtual double GetLikelihood() = 0;
+  virtual MeasurementVector GetRealZ() = 0;
+  virtual unique_ptr<ModeFilter> Clone() const = 0;
+  /*The track, not the filter: model fingerprint, time index, x, the upper triangle of P and the last measurement, at
+   * the filter's precision. The process noise streams stay with the filter. LoadState throws on another model.*/
+  virtual void SaveState(ostream& os) const = 0;
+  virtual void LoadState(istream& is) = 0;
+  /*The cold form of a dormant track: x at the filter's precision and the upper triangle of P row by row, at float or
+   * double. Thaw puts it back into a filter on the same model, the next update rebuilds all the rest.*/
+  virtual int NumStates() const = 0;
+  virtual uint64_t ModelFingerprint() const = 0;
+  virtual void Freeze(StateScalar* x, float* P) const = 0;
+  virtual void Freeze(StateScalar* x, double* P) const = 0;
+  virtual void Thaw(const StateScalar* x, const float* P) = 0;
+  virtual void Thaw(const StateScalar* x, const double* P) = 0;
+};
+
+#endif //ESTIMATION_PROJECT_2016_MODEFILTER_H
@@ -0,0 +1,82 @@
+//
+// Created by clancy on 5/9/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_MONTECARLOSTUDY_H
+#define ESTIMATION_PROJECT_2016_MONTECARLOSTUDY_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "EstimationTPTypeDefinitions.h"
+#include "StudyConfiguration.h"
+#include "PerformanceEvaluator.h"
+#include "IMM.h"
+#include "RangeSensor.h"
+#include "AzimuthSensor.h"
+#include "ShadowKalmanFilter.h"
+#include "TrackFusion.h"
+
+using namespace std;
+
+/*The term project Monte Carlo study: immCT, immL and the CV filter (and optionally the particle filter) run over
+ * NUM_SAMPLES measurements of the same trajectory per trial.
+ *
+ * All randomness is derived from the configured seed and the trial index: every trial reseeds the sensors and its
+ * filters from (seed, trial), so a trial draws the same noise whichever process runs it and in whatever order.
+ * A checkpoint is then just the seed, the study's settings and hash, the trial range done so far and the evaluators'
+ * running sums. It is enough to resume with bit-identical results, and checkpoints of disjoint trial ranges of one
+ * study merge into the results of one big run.
+ *
+ * With a precision target the study is sequential: after every trial the confidence interval half-widths of each
+ * filter's RMS position error and ANEES are checked against the targets, and the study stops as soon as all are met
+ * or the trial budget runs out. The intervals are over trials, of each trial's time average.
+ *
+ * Two variance reduction options narrow the intervals for the same trials. Antithetic pairs: trial 2m+1 draws the
+ * sensor and process noise of trial 2m mirrored, and the pair's average is one sample. Control variates: a shadow CV
+ * filter with fixed gains runs on each trial's sensor noise, its error has an exactly known expectation, and the
+ * intervals are the regression ones on it. The per time step results are plain averages over trials either way.
+ * Mirroring only pays off for metrics that are close to odd in the noise; squared errors and NEES are close to even,
+ * so for them the pairs are positively correlated and the control variates are the option to use.
+ *
+ * A distributed network runs an immCT on every radar's own measurements besides the centralized bank, and fuses the
+ * radars' tracks every scan by covariance intersection; the fused track is evaluated as "t2t".*/
+class MonteCarloStudy {
+  StudyConfiguration _config;
+  CVKalmanFilter<> _kf;//the bank is built once per configuration and reset and reseeded in place every trial
+  IMM<> _immCT, _immL;
+  RangeSensor _range;
+  AzimuthSensor _azimuth;
+  ShadowKalmanFilter _shadow;//control variates
+  vector<IMM<>> _nodes;//distributed: an immCT per radar on its own measurements
+  TrackFusion _fusion;
+  PerformanceEvaluator _peIMMCT, _peIMML, _peKF, _pePF, _peT2T;
+  vector<PerformanceEvaluator*> _PEs;
+  vector<string> _peNames;//results store prefix of each evaluator
+  int _firstTrial, _trial;//trials [_firstTrial,_trial) are done
+  vector<pair<int,int>> _mergedRanges;
+  uint64_t _mergedStudy = 0;//the study hash of the merged shards
+
+  void RunTrial(int trial);
+  bool TargetsMet();//adaptive mode: every filter's intervals are within the configured half-widths
+  pair<double,double> TrialInterval(PerformanceEvaluator& pe, string key);//mean and half-width, controlled if configured
+
+  public:
+  MonteCarloStudy(StudyConfiguration config);
+
+  void Run();//runs the remaining trials, or until the precision targets are met, checkpointing on the way if configured
+  void Finish();//final results, text files and the results store
+  void SaveCheckpoint(string filename);
+  void LoadCheckpoint(string filename);
+  void MergeCheckpoint(string filename);//adds the sums of another shard's checkpoint
+  int GetCompletedTrials();
+
+  static void CheckpointConfiguration(string filename, StudyConfiguration& config);//the settings it was run with
+  static int CheckpointCompletedTrials(string filename);
+  static uint32_t CheckpointVersion();
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_MONTECARLOSTUDY_H
@@ -0,0 +1,45 @@
+//
+// Created by clancy on 5/2/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_MOTIONMODELS_H
+#define ESTIMATION_PROJECT_2016_MOTIONMODELS_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "KalmanFilter.h"
+#include "ExtendedKalmanFilter.h"
+
+#include <random>
+#include <cmath>
+
+/*The models are built in DataType and then stored at the requested precision. Passing the same seed gives the same
+ * process noise draws whatever the precision, which is what the precision comparison relies on.*/
+
+/*Nearly constant velocity: x, xDot, y, yDot driven by white acceleration noise*/
+template<class PrecisionPolicy = DoublePrecision>
+CVKalmanFilter<PrecisionPolicy> setupCVKalmanFilter(StateVector sensorState,
+                                                    TimeType Ts,
+                                                    CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                    double sigmaR,
+                                                    double sigmaTheta,
+                                                    unsigned seed = random_device()());
+
+/*Coordinated turn with unknown turn rate, linearized about the estimate*/
+template<class PrecisionPolicy = DoublePrecision>
+CTExtendedKalmanFilter<PrecisionPolicy> setupCTExtendedKalmanFilter(StateVector sensorState,
+                                                                    TimeType Ts,
+                                                                    CTExtendedKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                                    double sigmaR,
+                                                                    double sigmaTheta,
+                                                                    unsigned seed = random_device()());
+
+/*Nearly constant acceleration (Wiener process acceleration): x, xDot, y, yDot, xDDot, yDDot*/
+template<class PrecisionPolicy = DoublePrecision>
+CAKalmanFilter<PrecisionPolicy> setupCAKalmanFilter(StateVector sensorState,
+                                                    TimeType Ts,
+                                                    CAKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                    double sigmaR,
+                                                    double sigmaTheta,
+                                                    unsigned seed = random_device()());
+
+#endif //ESTIMATION_PROJECT_2016_MOTIONMODELS_H
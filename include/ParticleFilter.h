@@ -0,0 +1,99 @@
+//
+// Created by clancy on 5/5/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_PARTICLEFILTER_H
+#define ESTIMATION_PROJECT_2016_PARTICLEFILTER_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "MeasurementConverter.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*Bootstrap particle filter on the raw range/azimuth measurements. Every particle carries x, xDot, y, yDot, omega and a
+ * mode (0 = CV, 1 = CT) that switches with the same Markov matrix as the IMM, so the particle cloud is a jump Markov
+ * version of immCT.
+ *
+ * Particles are stored as structure of arrays so that propagation and likelihood run as Eigen array expressions over
+ * contiguous columns. Eigen vectorizes the arithmetic, sqrt, exp and log for double; sin, cos and atan2 are scalar
+ * calls per particle. The particles are split into a fixed number of contiguous chunks, each with its own generator,
+ * and partial sums are reduced in chunk order, so results only depend on the seed, whatever the thread count.
+ * The threads are started once per filter: worker w runs chunks w, w+numThreads, ... of every phase, the calling
+ * thread is worker 0.*/
+class ParticleFilter {
+  typedef Array<DataType,Dynamic,1> Column;
+  typedef Array<int,Dynamic,1> ModeColumn;
+
+  StateVector _sensorState;
+  double _sigmaR, _sigmaTheta;
+  TimeType _Ts;
+  double _sigmaAccelerationCV, _sigmaAccelerationCT, _sigmaOmega, _sigmaOmegaInitial;
+  TransitionMatrix _p;
+  double _resampleThreshold;//resample when the effective sample size falls below this fraction of the particles
+  int _numParticles, _numChunks, _numThreads;
+  volatile int _t = 0;
+
+  Column _x, _xDot, _y, _yDot, _omega, _logWeight, _weight;
+  ModeColumn _mode;
+  Column _xNext, _xDotNext, _yNext, _yDotNext, _omegaNext;//resampling double buffers
+  ModeColumn _modeNext;
+  Column _cumulativeWeight, _noise1, _noise2, _noise3, _uniform;
+  Array<int,Dynamic,1> _ancestor;
+  vector<int> _chunkBegin;//_numChunks+1 boundaries
+  vector<mt19937> _generators;//one per chunk
+
+  vector<thread> _workers;
+  mutex _phaseMutex;
+  condition_variable _phaseStart, _phaseDone;
+  const function<void(int,int,int)>* _phase = nullptr;
+  unsigned _phaseNumber = 0;//a worker runs a phase once it sees a new number
+  int _busyWorkers = 0;
+  bool _stopping = false;
+
+  StateVector _xEstimate;
+  StateCovarianceMatrix _PEstimate;
+  MeasurementVector _zReal;
+  double _effectiveSampleSize, _MOD2PR;
+
+  void ParallelFor(function<void(int chunk,int begin,int end)> f);
+  void RunChunks(const function<void(int,int,int)>& f, int worker);
+  void Work(int worker);
+  void Propagate();
+  void Weigh(MeasurementVector z);
+  void Normalize();
+  void Resample();
+  void Estimate();
+
+  public:
+  ParticleFilter(StateVector sensorState,
+                 double sigmaR,
+                 double sigmaTheta,
+                 TimeType Ts,
+                 double sigmaAccelerationCV,
+                 double sigmaAccelerationCT,
+                 double sigmaOmega,
+                 int numParticles,
+                 int numThreads = thread::hardware_concurrency(),
+                 unsigned seed = random_device()());
+  ~ParticleFilter();
+
+  void Initialize(MeasurementVector z0,MeasurementVector z1);
+  pair<StateVector,StateCovarianceMatrix> Update(MeasurementVector measurement);
+  pair<StateVector,StateCovarianceMatrix> Update(const ConvertedMeasurement& measurement);//weighs on the raw polar
+  pair<StateVector,StateCovarianceMatrix> GetEstimate();
+  MeasurementVector GetRealZ();
+  double GetMOD2PR();//weight of the CT mode
+  double GetEffectiveSampleSize();
+  int GetNumParticles();
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_PARTICLEFILTER_H
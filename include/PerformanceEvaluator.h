@@ -17,6 +17,9 @@
 #include <tuple>
 
 #include "EstimationTPTypeDefinitions.h"
+#include "BinaryIO.h"
+#include "QuantileSketch.h"
+#include "RunningStatistics.h"
 
 using namespace std;
 using SVref = StateVector&;
@@ -30,17 +33,22 @@ class PerformanceEvaluator {
   volatile int _runCount = 0;
   string _filepath;
   map<string,tuple<VecPtr,PerformanceFunction,FinishFunction>> _performanceValueTuples;
+  map<string,pair<vector<QuantileSketch>,PerformanceFunction>> _distributions;//one sketch per time step
+  vector<double> _quantiles;//reported for every distribution
+  map<string,double> _runSums;//of the current run, for the values whose per trial averages are tracked
+  map<string,RunningStatistics> _trialStatistics;//over trials, of each run's average
+  map<string,ControlledStatistics> _controlledStatistics;//the same with the study's control variates
+  bool _pairedRuns = false, _pairOpen = false;
+  map<string,pair<double,double>> _pendingRun;//average and control of the first run of an open pair
 
   double Square(double x);
 
   double CalculateNORXE(SVref xEst,SCMref P,SVref xReal);
   double CalculateFPOS(SVref xEst,SCMref P,SVref xReal);
   double CalculateFVEL(SVref xEst,SCMref P,SVref xReal);
-  double CalculatePOS(SVref xEst,SCMref P,SVref xReal);
   double CalculateVEL(SVref xEst,SCMref P,SVref xReal);
   double CalculateSPD(SVref xEst,SCMref P,SVref xReal);
   double CalculateCRS(SVref xEst,SCMref P,SVref xReal);
-  double CalculateNEES(SVref xEst,SCMref P,SVref xReal);
 
   void CalculateAverage(VecPtr vec);//mean
   void CalculateRM(VecPtr vec);//root mean
@@ -50,10 +58,36 @@ class PerformanceEvaluator {
   PerformanceEvaluator(string filename);
 
   void EvaluateIntermediate(pair<StateVector,StateCovarianceMatrix> estimate,double MOD2PR,MeasurementVector z, StateVector xReal);
-  void FinishEvaluatingRun();
+  /*Estimates at reduced precision are widened before evaluation, the sums are always kept in DataType*/
+  template<typename StateScalar, typename CovarianceScalar>
+  void EvaluateIntermediate(pair<Matrix<StateScalar,NUM_STATES,1>,Matrix<CovarianceScalar,NUM_STATES,NUM_STATES>> estimate,
+                            double MOD2PR,
+                            MeasurementVector z,
+                            StateVector xReal) {
+    EvaluateIntermediate(make_pair(estimate.first.template cast<DataType>().eval(),
+                                   estimate.second.template cast<DataType>().eval()),MOD2PR,z,xReal);
+  }
+  /*controls: per run control variates of the tracked averages, zero mean, keyed like them*/
+  void FinishEvaluatingRun(const map<string,double>& controls = map<string,double>());
+  /*Antithetic pairs: two consecutive runs are one sample of the trial statistics. Checkpoint between pairs only.*/
+  void SetPairedRuns(bool paired);
   void CalculateFinalResults();
   void WriteResultsToFile();
 
+  /*one estimate's position error and NEES, over the states the model carries*/
+  static double CalculatePOS(SVref xEst,SCMref P,SVref xReal);
+  static double CalculateNEES(SVref xEst,SCMref P,SVref xReal);
+
+  vector<double> GetResult(string key);
+  vector<double> GetQuantile(string key,double q);//per time step, e.g. GetQuantile("POS",.99)
+  /*Over trials, of each trial's time average: the squared position error for "RMSPOS", NEES for "NEES"*/
+  const RunningStatistics& GetTrialStatistics(string key);
+  const ControlledStatistics& GetControlledStatistics(string key);
+  vector<pair<string,vector<double>>> GetColumns();//every final result and quantile, named as in the text files
+  void SaveState(ostream& os);//the running sums, only meaningful before CalculateFinalResults
+  void LoadState(istream& is);
+  void Merge(PerformanceEvaluator& other);//adds another evaluator's running sums, e.g. from a shard
+
   void SetFilePath(string filepath);
   void SetRawPerformancePath(string filepath);
 
@@ -0,0 +1,17 @@
+//
+// Created by clancy on 5/3/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_PRECISIONHARNESS_H
+#define ESTIMATION_PROJECT_2016_PRECISIONHARNESS_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "StudyConfiguration.h"
+#include "PerformanceEvaluator.h"
+
+/*Runs the study's filter bank at double, single and mixed precision on identical measurement streams and process
+ * noise seeds, then reports how far RMSPOS and NEES move from the double precision results. Returns nonzero when
+ * any relative deviation exceeds the tolerance.*/
+int ComparePrecisions(const StudyConfiguration& config, double tolerance);
+
+#endif //ESTIMATION_PROJECT_2016_PRECISIONHARNESS_H
@@ -0,0 +1,43 @@
+//
+// Created by clancy on 5/10/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_QUANTILESKETCH_H
+#define ESTIMATION_PROJECT_2016_QUANTILESKETCH_H
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*Merging t-digest (Dunning). Centroids and unsorted new points share one buffer whose capacity is fixed at
+ * construction; when it fills up everything is sorted and merged back under the arcsine scale function, which keeps
+ * at most ~compression centroids and makes them smallest in the tails, where p95/p99 are read. Memory doesn't depend
+ * on how many values are added, and two sketches merge by feeding one's centroids into the other.*/
+class QuantileSketch {
+  double _compression;
+  size_t _capacity;
+  vector<pair<double,double>> _centroids;//(mean, weight), sorted up to _sorted
+  size_t _sorted = 0;
+  double _count = 0, _min = 0, _max = 0;
+
+  void AddWeighted(double mean,double weight);
+  double ScaleInverse(double k);
+
+  public:
+  QuantileSketch(double compression = 200);
+
+  void Add(double x);
+  void Merge(const QuantileSketch& other);
+  void Compress();
+  double Quantile(double q);
+  double Count();
+  size_t NumCentroids();
+
+  void SaveState(ostream& os) const;
+  void LoadState(istream& is);
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_QUANTILESKETCH_H
@@ -0,0 +1,33 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_RESULTCACHE_H
+#define ESTIMATION_PROJECT_2016_RESULTCACHE_H
+
+#include "StudyConfiguration.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/*A local cache of study results, addressed by content. The key hashes every configuration value that changes what a
+ * trial computes, together with the bytes of the trajectory file, the checkpoint format version and the models the
+ * configuration builds (their fingerprints, H, Q and kernels); the trial count, the stopping rule, checkpointing and
+ * pipelining don't change a trial and are left out. An entry is the study's checkpoint of the trials done so far
+ * from firstTrial on, so a repeated study is read back instead of rerun and a longer one resumes from it.
+ * The rest of the code isn't in the key: a change to the filter equations, the sensors or the evaluators must bump
+ * cacheVersion, or stale entries are read back as if current.*/
+string ResultCacheKey(const StudyConfiguration& config);//16 hex digits, FNV-1a
+string ResultCachePath(const StudyConfiguration& config);//the entry in config.cacheDirectory, which is created if missing
+
+/*The study the key is made of: the hash covers everything but the first trial, so every shard of one study shares it.
+ * The settings are the hashed configuration values without the trajectory bytes and the seed, written in a form a
+ * checkpoint can carry and a merge rebuild the study from.*/
+uint64_t StudyHash(const StudyConfiguration& config);
+void WriteStudySettings(ostream& os, const StudyConfiguration& config);
+void ReadStudySettings(istream& is, StudyConfiguration& config);
+
+#endif //ESTIMATION_PROJECT_2016_RESULTCACHE_H
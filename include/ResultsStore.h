@@ -0,0 +1,43 @@
+//
+// Created by clancy on 5/15/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_RESULTSSTORE_H
+#define ESTIMATION_PROJECT_2016_RESULTSSTORE_H
+
+#include "PerformanceEvaluator.h"
+#include "StudyConfiguration.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*Every filter x metric x time step of a study, plus its metadata, in one columnar file, so a sweep is analysed with
+ * one read per study instead of a text file per metric. Layout, host byte order:
+ *   "ETPRSLT", uint32 version
+ *   uint32 metadata count, then (key, value) strings
+ *   uint32 column count, uint64 row count, then the column names ("immCT/RMSPOS", "kf/POS_p99", ...)
+ *   column count x row count doubles, column after column
+ * Strings are a uint64 length and the bytes. Columns shorter than the row count are padded with NaN.
+ * Octave Scripts/load_results_store.m reads it.*/
+class ResultsStore {
+  vector<pair<string,string>> _metadata;
+  vector<pair<string,vector<double>>> _columns;
+
+  public:
+  void AddMetadata(string key, string value);
+  void AddConfiguration(const StudyConfiguration& config, int completedTrials);
+  void AddColumn(string name, vector<double> values);
+  void AddEvaluator(string filter, PerformanceEvaluator& pe);//call after CalculateFinalResults
+
+  void Write(string filename);
+  static ResultsStore Read(string filename);
+
+  const vector<pair<string,string>>& GetMetadata();
+  const vector<pair<string,vector<double>>>& GetColumns();
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_RESULTSSTORE_H
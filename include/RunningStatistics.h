@@ -0,0 +1,51 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_RUNNINGSTATISTICS_H
+#define ESTIMATION_PROJECT_2016_RUNNINGSTATISTICS_H
+
+#include <initializer_list>
+#include <iostream>
+
+using namespace std;
+
+/*Mean and variance of a stream of values, updated one value at a time (Welford) so nothing is kept per value. Two
+ * accumulators merge exactly with the pairwise update of Chan et al., which is what shards need.*/
+class RunningStatistics {
+  double _count = 0, _mean = 0, _m2 = 0;//_m2 is the sum of squared deviations from the mean
+
+  public:
+  void Add(double x);
+  void Merge(const RunningStatistics& other);
+  double Count() const;
+  double Mean() const;
+  double Variance() const;//sample variance, NaN below two values
+  double HalfWidth(double confidence) const;//of the two sided Student t confidence interval of the mean
+
+  void SaveState(ostream& os);
+  void LoadState(istream& is);
+};
+
+/*Mean of y with a control variate c of known zero mean (pass the control minus its expectation). The estimate is
+ * mean(y) - beta*mean(c) with beta fitted by least squares, and its interval is the regression one for the intercept,
+ * with n-2 degrees of freedom (Lavenberg and Welch), so fitting beta from the same trials is accounted for.*/
+class ControlledStatistics {
+  double _count = 0, _meanY = 0, _meanC = 0;
+  double _m2Y = 0, _m2C = 0, _m2YC = 0;//sums of squared deviations and of their cross products
+
+  public:
+  void Add(double y, double c);
+  void Merge(const ControlledStatistics& other);
+  double Count() const;
+  double Beta() const;
+  double Correlation() const;//of y and c, the controlled variance is about 1-rho^2 of the plain one
+  double Mean() const;
+  double HalfWidth(double confidence) const;
+
+  void SaveState(ostream& os);
+  void LoadState(istream& is);
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_RUNNINGSTATISTICS_H
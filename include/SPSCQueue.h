@@ -0,0 +1,54 @@
+//
+// Created by clancy on 5/12/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_SPSCQUEUE_H
+#define ESTIMATION_PROJECT_2016_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+using namespace std;
+
+/*Bounded lock-free ring buffer for exactly one producer thread and one consumer thread. Each index is only written by
+ * its own side; the release store publishing it pairs with the other side's acquire load. Indices live on their own
+ * cache lines so the two threads don't false share. Capacity must be a power of two.*/
+template<class T, size_t Capacity>
+class SPSCQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity-1)) == 0, "capacity must be a power of two");
+
+  alignas(64) atomic<size_t> _head{0};//next slot to pop, written by the consumer
+  alignas(64) atomic<size_t> _tail{0};//next slot to push, written by the producer
+  alignas(64) array<T,Capacity> _slots;
+
+  public:
+  bool TryPush(const T& value) {
+    size_t tail = _tail.load(memory_order_relaxed);
+    if(tail - _head.load(memory_order_acquire) == Capacity) return false;//full
+    _slots[tail & (Capacity-1)] = value;
+    _tail.store(tail+1,memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    size_t head = _head.load(memory_order_relaxed);
+    if(head == _tail.load(memory_order_acquire)) return false;//empty
+    value = _slots[head & (Capacity-1)];
+    _head.store(head+1,memory_order_release);
+    return true;
+  }
+
+  /*Blocking versions spin briefly, then yield so an oversubscribed machine still makes progress*/
+  void Push(const T& value) {
+    for(int spins = 0;!TryPush(value);spins++) if(spins > 64) this_thread::yield();
+  }
+
+  void Pop(T& value) {
+    for(int spins = 0;!TryPop(value);spins++) if(spins > 64) this_thread::yield();
+  }
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_SPSCQUEUE_H
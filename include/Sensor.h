@@ -20,6 +20,12 @@ class Sensor {
   random_device _rd;
   mt19937 _generator;
   normal_distribution<double> _distribution;
+  bool _antithetic = false;//mirror every draw about the mean
+
+  double Noise() {
+    double noise = _distribution(_generator);
+    return _antithetic ? 2*_distribution.mean() - noise : noise;
+  }
 
   public:
   Sensor(StateVector sensorState, double mean, double stddev):
@@ -28,6 +34,13 @@ class Sensor {
           _generator(_rd()),
           _distribution(mean,stddev){}
   virtual double Measure(Target& aTarget) = 0;
+
+  /*The antithetic stream of a seed draws the same values mirrored, for antithetic pairs of trials*/
+  void Seed(unsigned seed, bool antithetic = false) {
+    _generator.seed(seed);
+    _distribution.reset();
+    _antithetic = antithetic;
+  }
 };
 
 
@@ -0,0 +1,60 @@
+//
+// Created by clancy on 5/16/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_SENSORNETWORK_H
+#define ESTIMATION_PROJECT_2016_SENSORNETWORK_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "MeasurementConverter.h"
+#include "RangeSensor.h"
+#include "AzimuthSensor.h"
+#include "Target.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*One range/azimuth radar of a network: where it is and how noisy it is*/
+struct SensorSite {
+  StateVector sensorState;
+  double sigmaR, sigmaTheta;//std dev
+};
+
+/*A range/azimuth pair tagged with the radar that measured it*/
+struct SensorMeasurement {
+  int sensor;
+  MeasurementVector z;
+};
+
+/*Centralized fusion for a network of radars. Each measurement is converted with its own radar's position and noise,
+ * and every radar measures the same position, so a scan fuses in information form:
+ *   R^-1 = sum Ri^-1, z = R * sum Ri^-1 zi
+ * That is additive, costs a 2x2 closed form inverse per radar and one inversion per scan, and the result is an
+ * ordinary converted measurement: every filter and the IMM update with it as if it came from one very good radar.*/
+class SensorNetwork {
+  vector<SensorSite> _sites;
+  vector<MeasurementConverter> _converters;
+  vector<unique_ptr<RangeSensor>> _range;//simulation only
+  vector<unique_ptr<AzimuthSensor>> _azimuth;
+
+  public:
+  SensorNetwork(const vector<SensorSite>& sites);
+
+  int AddSensor(const SensorSite& site);//returns the new radar's ID
+  int Size() const;
+  const SensorSite& GetSite(int sensor) const;
+  const MeasurementConverter& GetConverter(int sensor) const;
+
+  /*Radar k's noise comes from (seed, k), so adding radars leaves the existing streams alone*/
+  void Seed(unsigned seed, bool antithetic = false);
+  void Measure(Target& aTarget, vector<SensorMeasurement>& measurements);//one measurement per radar, reused
+  ConvertedMeasurement Fuse(const vector<SensorMeasurement>& measurements) const;//polar is as radar 0 sees it
+
+  static vector<SensorSite> ReadSites(string filename);//a radar per line: x, y, sigmaR, sigmaTheta
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_SENSORNETWORK_H
@@ -0,0 +1,45 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_SHADOWKALMANFILTER_H
+#define ESTIMATION_PROJECT_2016_SHADOWKALMANFILTER_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "KalmanFilter.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*Control variates for the study's metrics. A CV Kalman filter whose gains are fixed in advance from the truth runs on
+ * the sensors' noise linearized at the truth, so its error is linear in the Gaussian draws: the mean and covariance of
+ * its error at every step follow exactly from a recursion, and with them the expectations of its squared position
+ * error and of its NEES. It sees the same draws as the real filters, which is what makes it a control for them.*/
+class ShadowKalmanFilter {
+  typedef Matrix<DataType,CV_STATES,1> CVVector;
+  typedef Matrix<DataType,CV_STATES,CV_STATES> CVMatrix;
+  typedef Matrix<DataType,CV_STATES,NUM_MEASUREMENTS> CVGainMatrix;
+
+  StateVector _sensorState;
+  double _sigmaR, _sigmaTheta;
+  TimeType _Ts;
+  CVMatrix _F, _Q;
+  Matrix<DataType,NUM_MEASUREMENTS,CV_STATES> _H;
+
+  Matrix2d NoiseGain(const StateVector& truth) const;//polar to Cartesian, at the truth
+
+  public:
+  ShadowKalmanFilter(StateVector sensorState, double sigmaR, double sigmaTheta, TimeType Ts,
+                     CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V);
+
+  /*truth[k] and noise[k] (range, azimuth) at every measurement of a run, the first two initialize. The controls are
+   * time averages over the rest, like the evaluators' trial statistics and under the same keys, minus their
+   * expectations*/
+  map<string,double> Controls(const vector<StateVector>& truth, const vector<MeasurementVector>& noise) const;
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_SHADOWKALMANFILTER_H
@@ -0,0 +1,100 @@
+//
+// Created by clancy on 5/3/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_STUDYCONFIGURATION_H
+#define ESTIMATION_PROJECT_2016_STUDYCONFIGURATION_H
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "EstimationTPTypeDefinitions.h"
+#include "KalmanFilter.h"
+#include "ExtendedKalmanFilter.h"
+#include "SensorNetwork.h"
+
+using namespace std;
+
+/*Everything that defines the term project Monte Carlo study. Defaults are the term project values.*/
+struct StudyConfiguration {
+  string path = "/home/clancy/Projects/Estimation Project 2016/Testing Data/";
+  string trajectoryFile = path + "Generated Target Trajectories/Term Project Data.txt";
+  StateVector sensorState;
+  double sigmaR = 50, sigmaTheta = .01745;//std dev, 1 deg in radians
+  TimeType Ts = 10;
+  int samplesPerStep = 10;//trajectory lines per sampling period
+  CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V1,V2;//stddev
+  CTExtendedKalmanFilter<>::ModelVProcessNoiseGainMatrix V3;
+  int firstTrial = 0;//a shard runs trials [firstTrial, firstTrial+numTrials)
+  int numTrials = NUM_TRIALS;
+  unsigned seed = random_device()();//every noise stream in the study is derived from this
+  bool pipelined = false;//truth+sensor, filter and evaluation stages on their own threads, same results
+
+  /*adaptive trial count, enabled by a precision target: trials stop once every filter's confidence interval
+   * half-widths are within the targets, numTrials is then only the budget*/
+  double targetRMSPOS = 0;//m, of the RMS position error over the run, 0 for no target
+  double targetANEES = 0;//of the average NEES, 0 for no target
+  double confidence = .95;
+  int minTrials = 10;//before the intervals are trusted
+
+  /*variance reduction for the intervals*/
+  bool antithetic = false;//trials 2m and 2m+1 draw mirrored noise, a pair is one sample
+  bool controlVariates = false;//a shadow CV filter's error on the same sensor noise controls every filter's averages
+
+  /*checkpointing, enabled by naming a file*/
+  string checkpointFile;
+  int checkpointInterval = 10;//trials
+
+  /*result cache, enabled by naming a directory: a study already in it is read back, a longer one resumes from it*/
+  string cacheDirectory;
+
+  /*particle filter, run alongside the bank with --particle-filter*/
+  bool runParticleFilter = false;
+  int numParticles = 10000;
+  int numThreads = max(1u,thread::hardware_concurrency());//the results don't depend on it
+  double pfSigmaAccelerationCV = 1, pfSigmaAccelerationCT = 3;//m/s^2
+  double pfSigmaOmega = .005;//rad/s per step
+
+  /*clutter, enabled with --clutter: the bank then runs PDA / IMM-PDA on every scan*/
+  bool clutter = false;
+  double falseAlarmRate = 100;//per scan
+  double Pd = .9, Pg = .9997;
+  double clutterRMin = 5000, clutterRMax = 110000;//m from the sensor, covers the term project trajectory
+  double clutterThetaMin = -.2, clutterThetaMax = 2.5;//rad
+
+  /*missed detections on the single sensor, set with --miss-probability: the bank coasts over every missed scan*/
+  double missProbability = 0;
+
+  /*radar network, set with --sensors FILE: replaces the single sensor, every scan is fused before the bank sees it*/
+  vector<SensorSite> network;
+  bool distributed = false;//with --distributed every radar also tracks on its own and the tracks are fused
+  double fusionGate = 1000;//squared distance; the radars' immCT tracks are overconfident (ANEES ~ 11), so the
+                           //consistent 99% gate of 13.28 turns away a fifth of the true pairs
+
+  bool Adaptive() const { return targetRMSPOS > 0 || targetANEES > 0; }
+
+  StudyConfiguration() {
+    sensorState << -10000,0,0,0,0;//for term project
+    V1 << .2, 0,
+          0, .2;//sigma v
+    V2 << 6.0, 0,
+          0, 6.0;//sigma v
+    V3 << 1, 0, 0,
+          0, 1, 0,
+          0, 0, .005;
+  }
+};
+
+/*A trial's noise streams: range, azimuth, kf1, kf2, ekf1 and the particle filter. seed_seq's output depends on how
+ * many values are asked for, so everything that reproduces a trial takes them from here.*/
+inline array<uint32_t,6> TrialStreamSeeds(unsigned seed, unsigned trial) {
+  seed_seq trialSeeds{seed,trial};
+  array<uint32_t,6> streamSeeds;
+  trialSeeds.generate(streamSeeds.begin(),streamSeeds.end());
+  return streamSeeds;
+}
+
+#endif //ESTIMATION_PROJECT_2016_STUDYCONFIGURATION_H
@@ -10,21 +10,28 @@
 #include <utility>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "EstimationTPTypeDefinitions.h"
 using namespace std;
 
+/*The truth, read from a trajectory file of knots. A dense file has a line x,xDot,y,yDot,omega per generator step
+ * (1 s), a sparse one timestamped lines t,x,xDot,y,yDot,omega, e.g. only where the maneuver changes. Between knots
+ * the target flies a coordinated turn at its knot's omega (rad/s), so StateAt is exact at any time. The generator
+ * leaves omega at zero in dense files, there it's recovered from the velocity's rotation to the next knot.*/
 class Target {
   string _dataFile;
-  StateVector _state;
-  ifstream _data;
+  vector<TimeType> _knotTimes;
+  vector<StateVector> _knots;
+  vector<DataType> _omega;//turn rate from each knot on
+  TimeType _time = 0;//of Sample, in generator steps from the first knot
+
   public:
   Target(string dataFile);
-  ~Target() {
-    _data.close();
-  }
   void Advance(int times = 1);
   StateVector Sample();
+  StateVector StateAt(TimeType t) const;
+  void WriteSparse(string dataFile) const;//knots only where the turn rate changes
 
   private:
   void Print(const string&& message);
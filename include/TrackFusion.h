@@ -0,0 +1,51 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_TRACKFUSION_H
+#define ESTIMATION_PROJECT_2016_TRACKFUSION_H
+
+#include "EstimationTPTypeDefinitions.h"
+
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/*Track to track fusion for distributed trackers: every node runs its own tracker on its own sensors and only shares
+ * its track estimates. The nodes' errors are correlated by the common process noise and by earlier exchanges, by an
+ * unknown amount, so tracks are combined by covariance intersection, which is consistent whatever the correlation:
+ *   P^-1 = w Pa^-1 + (1-w) Pb^-1,  x = P (w Pa^-1 xa + (1-w) Pb^-1 xb)
+ * with w minimizing det P. Tracks are associated by the Mahalanobis distance of their position and velocity.
+ *
+ * Tracks are in the common state. A state with zero variance is one the node's models don't carry (the CV models'
+ * omega); it is taken from the track that carries it, or left 0 if neither does.*/
+class TrackFusion {
+  public:
+  typedef pair<StateVector,StateCovarianceMatrix> Track;
+
+  private:
+  double _gate;//on the squared distance
+  int _numThreads;
+
+  public:
+  TrackFusion(double gate = 13.28, int numThreads = 1);//chi-square, 4 degrees of freedom, 99%
+
+  /*The weight comes from the generalized eigenvalues l of (Pa^-1, Pb^-1): det P^-1 is det Pb^-1 times the product of
+   * 1+w(l-1), whose log is concave in w, so the optimum is a root of a monotone function of one variable, found by
+   * safeguarded Newton steps in O(n) each*/
+  static Track Intersect(const Track& a, const Track& b, double* weight = nullptr);
+  static double Distance(const Track& a, const Track& b);//squared, position and velocity
+
+  /*Greedy global nearest neighbour: the closest pair inside the gate first, every track in at most one pair*/
+  vector<pair<int,int>> Associate(const vector<Track>& a, const vector<Track>& b) const;
+  /*Intersects every associated pair, split over the threads; fused[k] is pairs[k]'s result*/
+  void IntersectBatch(const vector<Track>& a, const vector<Track>& b, const vector<pair<int,int>>& pairs,
+                      vector<Track>& fused) const;
+  /*System tracks from every node's local tracks: node by node, each local track is intersected with the system
+   * track it associates with, or starts a new one*/
+  vector<Track> Fuse(const vector<vector<Track>>& nodes) const;
+};
+
+
+#endif //ESTIMATION_PROJECT_2016_TRACKFUSION_H
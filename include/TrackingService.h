@@ -0,0 +1,42 @@
+//
+// Created by clancy on 5/11/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_TRACKINGSERVICE_H
+#define ESTIMATION_PROJECT_2016_TRACKINGSERVICE_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "StudyConfiguration.h"
+
+#include <string>
+
+using namespace std;
+
+/*Wire format, fixed size records in host byte order. Every measurement frame gets exactly one estimate frame back.
+ * The track is initialized from the first two measurements, so the first reply is all NaN and the second holds the
+ * CV filter's initial estimate. Time is echoed and counted in scans of the configured Ts: a longer gap since the last
+ * measurement is coasted over before the update.*/
+struct MeasurementFrame {
+  double time, range, azimuth;
+};
+
+struct EstimateFrame {
+  double time;
+  double x[NUM_STATES];
+  double P[NUM_STATES*(NUM_STATES+1)/2];//upper triangle, row by row
+  double MOD2PR;
+  double latency;//seconds from the measurement being read to the estimate being ready
+};
+
+/*Runs immCT (CV KF + CT EKF) on measurements as they arrive. With an empty socket path it serves stdin/stdout once,
+ * otherwise it listens on a Unix domain socket and serves one client after another, each as a new track. Per-update
+ * latency histograms go to stderr whenever a client finishes.*/
+int ServeMeasurements(const StudyConfiguration& config, string socketPath);
+
+/*Simulates one trial of the study's target and sensors and replays it frame by frame. With "-" the frames are written
+ * to stdout (for piping into the stdin service), otherwise they are sent to the socket one at a time, the estimates
+ * are printed as text and the round trip latencies are reported on stderr. With a miss probability the frames of
+ * missed scans are left out, as in the study's trial 0.*/
+int ReplayMeasurements(const StudyConfiguration& config, string socketPath);
+
+#endif //ESTIMATION_PROJECT_2016_TRACKINGSERVICE_H
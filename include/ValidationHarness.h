@@ -0,0 +1,26 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#ifndef ESTIMATION_PROJECT_2016_VALIDATIONHARNESS_H
+#define ESTIMATION_PROJECT_2016_VALIDATIONHARNESS_H
+
+#include "EstimationTPTypeDefinitions.h"
+#include "StudyConfiguration.h"
+
+#include <string>
+
+/*Differential validation of a fast path against the reference: the study's bank (kf, immCT and immL) in double
+ * precision with every model on the dense F*P*F' kernel. Both banks run in lockstep on the study's measurement and
+ * process noise streams, trial by trial, and every step's common state, position error, NEES and mode probability
+ * are compared. The fast paths are
+ *   structured  double precision on the structural-zero covariance kernels, what the study runs
+ *   single      single precision, structured kernels
+ *   mixed       single precision states, double precision covariances, structured kernels
+ * A step diverges when |fast - reference| > tolerance*(1 + |reference|), with one tolerance for the state
+ * components and one for the metrics. Bitwise agreement can't be asked of immCT: its EKF and mode probabilities
+ * amplify rounding, reassociating the dense F*P*F' alone moves it by about 5e-3. Reports the maximum deviation of
+ * each and the first divergence, returns nonzero when anything diverged.*/
+int ValidateFastPath(const StudyConfiguration& config, const string& path, double stateTolerance, double metricTolerance);
+
+#endif //ESTIMATION_PROJECT_2016_VALIDATIONHARNESS_H
@@ -0,0 +1,146 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/AllocationHarness.h"
+#include "../include/IMM.h"
+#include "../include/MotionModels.h"
+#include "../include/PerformanceEvaluator.h"
+#include "../include/Target.h"
+#include "../include/RangeSensor.h"
+#include "../include/AzimuthSensor.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+namespace {
+atomic<uint64_t> allocationCount(0), allocatedBytes(0);
+
+struct AllocationCount {
+  uint64_t allocations, bytes;
+};
+
+AllocationCount Now() {
+  return {allocationCount.load(memory_order_relaxed),allocatedBytes.load(memory_order_relaxed)};
+}
+
+/*Allocations and bytes per call of one hot path*/
+struct CallCounter {
+  string name;
+  uint64_t calls = 0, allocations = 0, bytes = 0, maxAllocations = 0, maxBytes = 0;
+
+  template<class Call>
+  void Measure(Call call) {
+    AllocationCount before = Now();
+    call();
+    AllocationCount after = Now();
+    uint64_t n = after.allocations-before.allocations, size = after.bytes-before.bytes;
+    calls++;
+    allocations += n;
+    bytes += size;
+    maxAllocations = max(maxAllocations,n);
+    maxBytes = max(maxBytes,size);
+  }
+
+  bool Report(double budget) const {
+    bool pass = maxAllocations <= budget;
+    cout<<setw(22)<<name<<setw(8)<<calls<<setw(12)<<double(allocations)/max<uint64_t>(calls,1)<<setw(8)<<maxAllocations
+        <<setw(12)<<double(bytes)/max<uint64_t>(calls,1)<<setw(10)<<maxBytes<<(pass ? "   ok" : "   EXCEEDED")<<endl;
+    return pass;
+  }
+};
+}
+
+/*Every allocation in the program goes through these. The counters are relaxed atomics, the counts are only read
+ * around single threaded calls.*/
+void* operator new(size_t size) {
+  allocationCount.fetch_add(1,memory_order_relaxed);
+  allocatedBytes.fetch_add(size,memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if(!p) throw bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+  try { return operator new(size); }
+  catch(...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+  try { return operator new(size); }
+  catch(...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+int CheckAllocations(const StudyConfiguration& config, double budget) {
+  auto kf2 = setupCVKalmanFilter(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0);
+  IMM<> immCT(setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),
+              setupCTExtendedKalmanFilter(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,0));
+  IMM<> immL(setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),
+             setupCVKalmanFilter(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0));
+  RangeSensor range(config.sensorState,0,config.sigmaR);
+  AzimuthSensor azimuth(config.sensorState,0,config.sigmaTheta);
+  MeasurementConverter converter(config.sensorState,config.sigmaR,config.sigmaTheta);
+  PerformanceEvaluator peIMMCT, peIMML, peKF;
+  CallCounter kfUpdate, immCTUpdate, immLUpdate, evaluate;
+  kfUpdate.name = "KalmanFilter::Update";
+  immCTUpdate.name = "IMM::Update immCT";
+  immLUpdate.name = "IMM::Update immL";
+  evaluate.name = "EvaluateIntermediate";
+
+  for(int trial = 0;trial<=config.numTrials;trial++) {//trial 0 warms up
+    /*the study's streams, drawn before anything is counted*/
+    array<uint32_t,6> streamSeeds = TrialStreamSeeds(config.seed,unsigned(trial));
+    range.Seed(streamSeeds[0]);
+    azimuth.Seed(streamSeeds[1]);
+    Target target(config.trajectoryFile);
+    vector<ConvertedMeasurement> z;
+    vector<StateVector> truth;
+    for(int i = 0;i<NUM_SAMPLES+1;i++) {
+      MeasurementVector zi;
+      zi(0) = range.Measure(target);
+      zi(1) = azimuth.Measure(target);
+      z.push_back(converter.Convert(zi));
+      truth.push_back(target.Sample());
+      target.Advance(config.samplesPerStep);
+    }
+    kf2.Reset(streamSeeds[3]);
+    immCT.Reset({streamSeeds[2],streamSeeds[4]});
+    immL.Reset({streamSeeds[2],streamSeeds[3]});
+    kf2.Initialize(z[0],z[1]);
+    immCT.Initialize(z[0],z[1]);
+    immL.Initialize(z[0],z[1]);
+
+    bool counted = trial > 0;
+    CallCounter ignored;
+    for(size_t i = 2;i<z.size();i++) {
+      (counted ? kfUpdate : ignored).Measure([&] { kf2.Update(z[i]); });
+      (counted ? immCTUpdate : ignored).Measure([&] { immCT.Update(z[i]); });
+      (counted ? immLUpdate : ignored).Measure([&] { immL.Update(z[i]); });
+      auto kfEstimate = kf2.GetEstimate(), immCTEstimate = immCT.GetEstimate(), immLEstimate = immL.GetEstimate();
+      MeasurementVector kfZ = kf2.GetRealZ(), immCTZ = immCT.GetRealZ(), immLZ = immL.GetRealZ();
+      double immCTMode = immCT.GetMOD2PR(), immLMode = immL.GetMOD2PR();
+      (counted ? evaluate : ignored).Measure([&] { peIMMCT.EvaluateIntermediate(immCTEstimate,immCTMode,immCTZ,truth[i]); });
+      (counted ? evaluate : ignored).Measure([&] { peIMML.EvaluateIntermediate(immLEstimate,immLMode,immLZ,truth[i]); });
+      (counted ? evaluate : ignored).Measure([&] { peKF.EvaluateIntermediate(kfEstimate,0,kfZ,truth[i]); });
+    }
+    for(auto pe:{&peIMMCT,&peIMML,&peKF}) pe->FinishEvaluatingRun();
+  }
+
+  cout<<"heap allocations per call over "<<config.numTrials<<" trials, budget "<<budget<<endl;
+  cout<<setw(22)<<"path"<<setw(8)<<"calls"<<setw(12)<<"mean"<<setw(8)<<"max"<<setw(12)<<"mean bytes"
+      <<setw(10)<<"max bytes"<<endl;
+  bool pass = true;
+  for(auto counter:{&kfUpdate,&immCTUpdate,&immLUpdate,&evaluate}) pass &= counter->Report(budget);
+  return pass ? 0 : 1;
+}
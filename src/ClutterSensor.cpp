@@ -0,0 +1,55 @@
+//
+// Created by clancy on 5/14/16.
+//
+
+#include "../include/ClutterSensor.h"
+
+#include <algorithm>
+
+ClutterSensor::ClutterSensor(RangeSensor& range,
+                             AzimuthSensor& azimuth,
+                             double Pd,
+                             double falseAlarmRate,
+                             double rMin,
+                             double rMax,
+                             double thetaMin,
+                             double thetaMax):
+        _range(range),
+        _azimuth(azimuth),
+        _Pd(Pd),
+        _falseAlarmRate(falseAlarmRate),
+        _rMin(rMin),
+        _rMax(rMax),
+        _thetaMin(thetaMin),
+        _thetaMax(thetaMax){ }
+
+void ClutterSensor::Seed(unsigned seed) {
+  _generator.seed(seed);
+}
+
+/*The target return always draws from the range and azimuth streams, detected or not, so clutter settings don't
+ * shift the target noise*/
+void ClutterSensor::Scan(Target& aTarget, vector<MeasurementVector>& returns) {
+  returns.clear();
+  MeasurementVector z;
+  z(0) = _range.Measure(aTarget);
+  z(1) = _azimuth.Measure(aTarget);
+  _detected = uniform_real_distribution<double>(0,1)(_generator) < _Pd;
+  if(_detected) returns.push_back(z);
+  int falseAlarms = poisson_distribution<int>(_falseAlarmRate)(_generator);
+  uniform_real_distribution<double> r(_rMin,_rMax), theta(_thetaMin,_thetaMax);
+  for(int i = 0;i<falseAlarms;i++) {
+    z(0) = r(_generator);
+    z(1) = theta(_generator);
+    returns.push_back(z);
+  }
+  shuffle(returns.begin(),returns.end(),_generator);
+}
+
+double ClutterSensor::GetClutterDensity() {
+  return _falseAlarmRate/((_rMax-_rMin)*(_thetaMax-_thetaMin));
+}
+
+bool ClutterSensor::TargetDetected() {
+  return _detected;
+}
@@ -0,0 +1,66 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/ColdTrackStore.h"
+
+#include <stdexcept>
+
+template<class PrecisionPolicy, class ColdScalar>
+ColdTrackStore<PrecisionPolicy,ColdScalar>::ColdTrackStore(const IMM<PrecisionPolicy>& prototype):
+        _models(prototype.ModelFingerprint()),
+        _stateStride(prototype.ColdStateSize()),
+        _covarianceStride(prototype.ColdCovarianceSize()){}
+
+template<class PrecisionPolicy, class ColdScalar>
+void ColdTrackStore<PrecisionPolicy,ColdScalar>::Check(const IMM<PrecisionPolicy>& track) const {
+  if(track.ModelFingerprint() != _models) throw runtime_error("the track runs on other models than the store");
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+size_t ColdTrackStore<PrecisionPolicy,ColdScalar>::Freeze(const IMM<PrecisionPolicy>& track) {
+  size_t index = Size();
+  _x.resize(_x.size()+_stateStride);
+  _P.resize(_P.size()+_covarianceStride);
+  Freeze(track,index);
+  return index;
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+void ColdTrackStore<PrecisionPolicy,ColdScalar>::Freeze(const IMM<PrecisionPolicy>& track, size_t index) {
+  Check(track);
+  track.Freeze(&_x[index*_stateStride],&_P[index*_covarianceStride]);
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+void ColdTrackStore<PrecisionPolicy,ColdScalar>::Thaw(size_t index, IMM<PrecisionPolicy>& track) const {
+  Check(track);
+  track.Thaw(&_x[index*_stateStride],&_P[index*_covarianceStride]);
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+void ColdTrackStore<PrecisionPolicy,ColdScalar>::Remove(size_t index) {
+  size_t last = Size()-1;
+  if(index != last) {
+    copy(_x.begin()+last*_stateStride,_x.end(),_x.begin()+index*_stateStride);
+    copy(_P.begin()+last*_covarianceStride,_P.end(),_P.begin()+index*_covarianceStride);
+  }
+  _x.resize(last*_stateStride);
+  _P.resize(last*_covarianceStride);
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+size_t ColdTrackStore<PrecisionPolicy,ColdScalar>::Size() const {
+  return _x.size()/_stateStride;
+}
+
+template<class PrecisionPolicy, class ColdScalar>
+size_t ColdTrackStore<PrecisionPolicy,ColdScalar>::BytesPerTrack() const {
+  return _stateStride*sizeof(StateScalar)+_covarianceStride*sizeof(ColdScalar);
+}
+
+template class ColdTrackStore<DoublePrecision,double>;
+template class ColdTrackStore<DoublePrecision,float>;
+template class ColdTrackStore<SinglePrecision,float>;
+template class ColdTrackStore<MixedPrecision,double>;
+template class ColdTrackStore<MixedPrecision,float>;
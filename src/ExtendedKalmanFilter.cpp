@@ -4,15 +4,19 @@
 
 #include "../include/ExtendedKalmanFilter.h"
 
-ExtendedKalmanFilter::ExtendedKalmanFilter(){ }
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+ExtendedKalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ExtendedKalmanFilter(){ }
 
-ExtendedKalmanFilter::ExtendedKalmanFilter(StateVector sensorState,
-                                           double sigmaR,
-                                           double sigmaTheta,
-                                           TimeType Ts,
-                                           function<SystemMatrix(StateVector)> generateSystemMatrix,
-                                           MeasurementCovarianceMatrix R,
-                                           MeasurementMatrix H,
-                                           ProcessNoiseCovarianceMatrix Q,
-                                           function<StateVector(StateVector)> predictState):
-                                           KalmanFilter(sensorState,sigmaR,sigmaTheta,Ts,generateSystemMatrix,R,H,Q,predictState){ }
\ No newline at end of file
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+ExtendedKalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ExtendedKalmanFilter(shared_ptr<const typename Base::Model> model,
+                                                                                                   unsigned seed):
+        Base(model,seed){ }
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+unique_ptr<ModeFilter<PrecisionPolicy>> ExtendedKalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Clone() const {
+  return unique_ptr<ModeFilter<PrecisionPolicy>>(new ExtendedKalmanFilter(*this));
+}
+
+template class ExtendedKalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, DoublePrecision>;
+template class ExtendedKalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, SinglePrecision>;
+template class ExtendedKalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, MixedPrecision>;
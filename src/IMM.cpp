@@ -3,28 +3,79 @@
 //
 
 #include "../include/IMM.h"
+#include "../include/BinaryIO.h"
 
-IMM::IMM(KalmanFilter f1, KalmanFilter f2){
-  _filters.push_back(f1);
-  _filters.push_back(f2);
-  StateVector x;
-  StateCovarianceMatrix P;
-  x<< 0,0,0,0,0;
-  P<<0,0,0,0,0,
-     0,0,0,0,0,
-     0,0,0,0,0,
-     0,0,0,0,0,
-     0,0,0,0,0;
-  auto aPair = make_pair(x,P);
+template<class PrecisionPolicy>
+IMM<PrecisionPolicy>::IMM(const ModeFilter<PrecisionPolicy>& f1, const ModeFilter<PrecisionPolicy>& f2){
+  _filters.push_back(f1.Clone());
+  _filters.push_back(f2.Clone());
+  auto aPair = make_pair(IMMStateVector::Zero().eval(),IMMStateCovarianceMatrix::Zero().eval());
   _mixed.push_back(aPair);
   _mixed.push_back(aPair);
+  _estimates = _mixed;
   _p<<.95,.05,
       .05,.95;
   _muMode<<.5,.5;
+  _initialMuMode = _muMode;
 }
 
-pair<StateVector,StateCovarianceMatrix> IMM::Update(MeasurementVector z) {
-  CalculateMixingProbabilities();
+template<class PrecisionPolicy>
+IMM<PrecisionPolicy>::IMM(const IMM& other):
+        _x(other._x),
+        _P(other._P),
+        _p(other._p),
+        _muMix(other._muMix),
+        _muMode(other._muMode),
+        _c(other._c),
+        _initialMuMode(other._initialMuMode),
+        _mixed(other._mixed),
+        _estimates(other._estimates),
+        _Lambda(other._Lambda),
+        _transitionPowers(other._transitionPowers){
+  for(auto& f:other._filters) _filters.push_back(f->Clone());
+}
+
+template<class PrecisionPolicy>
+IMM<PrecisionPolicy>& IMM<PrecisionPolicy>::operator=(const IMM& other) {
+  if(this != &other) {
+    IMM copy(other);
+    swap(_filters,copy._filters);
+    _x = other._x;
+    _P = other._P;
+    _p = other._p;
+    _muMix = other._muMix;
+    _muMode = other._muMode;
+    _c = other._c;
+    _initialMuMode = other._initialMuMode;
+    _mixed = other._mixed;
+    _estimates = other._estimates;
+    _Lambda = other._Lambda;
+    _transitionPowers = other._transitionPowers;
+  }
+  return *this;
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Reset(initializer_list<unsigned> seeds, bool antithetic) {
+  if(seeds.size() != _filters.size()) throw invalid_argument("IMM::Reset needs a seed per model");
+  auto seed = seeds.begin();
+  for(auto& filter:_filters) filter->Reset(*seed++,antithetic);
+  _muMode = _initialMuMode;
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Initialize(const ConvertedMeasurement& z0, const ConvertedMeasurement& z1) {
+  for(auto& filter:_filters) filter->Initialize(z0,z1);
+}
+
+template<class PrecisionPolicy>
+typename IMM<PrecisionPolicy>::IMMEstimate IMM<PrecisionPolicy>::Update(MeasurementVector z) {
+  return Update(_filters[0]->GetConverter().Convert(z));//the models share the sensor, convert once for all of them
+}
+
+template<class PrecisionPolicy>
+typename IMM<PrecisionPolicy>::IMMEstimate IMM<PrecisionPolicy>::Update(const ConvertedMeasurement& z) {
+  CalculateMixingProbabilities(_p);
   Mix();
   GetLikelihoods(z);
   UpdateModeProbabilities();
@@ -32,153 +83,324 @@ pair<StateVector,StateCovarianceMatrix> IMM::Update(MeasurementVector z) {
   return make_pair(_x,_P);
 }
 
-pair<StateVector,StateCovarianceMatrix> IMM::GetEstimate() {
+template<class PrecisionPolicy>
+typename IMM<PrecisionPolicy>::IMMEstimate IMM<PrecisionPolicy>::UpdatePDA(const ConvertedScan& scan, const PDAParameters& pda) {
+  CalculateMixingProbabilities(_p);
+  Mix();
+  GetLikelihoods(scan,pda);
+  UpdateModeProbabilities();
+  Estimate();
+  return make_pair(_x,_P);
+}
+
+template<class PrecisionPolicy>
+typename IMM<PrecisionPolicy>::IMMEstimate IMM<PrecisionPolicy>::Coast(int k) {
+  if(k < 0) throw invalid_argument("can't coast backwards");
+  if(k == 0) return make_pair(_x,_P);
+  CalculateMixingProbabilities(TransitionPower(k));
+  Mix();
+  for(auto& filter:_filters) filter->Coast(k);
+  _muMode = _c;//no measurement, the predicted mode probabilities stand
+  Estimate();
+  return make_pair(_x,_P);
+}
+
+/*By squaring, every power on the way is kept*/
+template<class PrecisionPolicy>
+const typename IMM<PrecisionPolicy>::Types::TransitionMatrix& IMM<PrecisionPolicy>::TransitionPower(int k) {
+  auto found = _transitionPowers.find(k);
+  if(found != _transitionPowers.end()) return found->second;
+  typename Types::TransitionMatrix power;
+  if(k == 1) power = _p;
+  else {
+    typename Types::TransitionMatrix half = TransitionPower(k/2);
+    power = half*half;
+    if(k % 2 != 0) power = power*_p;
+  }
+  return _transitionPowers.emplace(k,power).first->second;
+}
+
+template<class PrecisionPolicy>
+typename IMM<PrecisionPolicy>::IMMEstimate IMM<PrecisionPolicy>::GetEstimate() {
   return make_pair(_x,_P);
 };
 /*WORKS*/
-void IMM::CalculateNormalizingConstants() {
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::CalculateNormalizingConstants(const typename Types::TransitionMatrix& p) {
   _c<<0,0;
   for(int j = 0;j<NUM_FILTERS;j++) {
     for(int i = 0;i<NUM_FILTERS;i++) {
-      _c(j) += _p(i,j)*_muMode(i);
+      _c(j) += p(i,j)*_muMode(i);
     }
   }
 }
 /*WORKS*/
-void IMM::CalculateMixingProbabilities() {
-  CalculateNormalizingConstants();
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::CalculateMixingProbabilities(const typename Types::TransitionMatrix& p) {
+  CalculateNormalizingConstants(p);
   for(int i = 0;i<NUM_FILTERS;i++) {
     for(int j = 0;j<NUM_FILTERS;j++) {
-      _muMix(i,j) = _p(i,j)*_muMode(i)/_c(j);
+      _muMix(i,j) = p(i,j)*_muMode(i)/_c(j);
     }
   }
 }
 /*WORKS*/
-void IMM::Mix() {
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Mix() {
   for(int i = 0;i<NUM_FILTERS;i++) {
-    _mixed[i].first <<0,0,0,0,0;
-    _mixed[i].second<<0,0,0,0,0,
-                      0,0,0,0,0,
-                      0,0,0,0,0,
-                      0,0,0,0,0,
-                      0,0,0,0,0;
+    _mixed[i].first.setZero();
+    _mixed[i].second.setZero();
+  }
+  for(int i = 0;i<NUM_FILTERS;i++) {
+    _estimates[i] = _filters[i]->GetEstimate();//embed each model once per mix
   }
   MixStateEstimates();
   MixStateCovarianceEstimates();
   for(int j = 0;j<NUM_FILTERS;j++) {
-      _filters[j].Reinitialize(_mixed[j]);
+      _filters[j]->Reinitialize(_mixed[j]);
   }
 }
 /*WORKS*/
-void IMM::MixStateEstimates() {
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::MixStateEstimates() {
   for(int j = 0;j<NUM_FILTERS;j++) {
     for(int i = 0;i<NUM_FILTERS;i++) {
-      StateVector xi = _filters[i].GetEstimate().first;
-      _mixed[j].first += xi*_muMix(i,j);
+      IMMStateVector xi = _estimates[i].first;
+      _mixed[j].first += xi*StateScalar(_muMix(i,j));
     }
   }
 }
 /*WORKS*/
-void IMM::MixStateCovarianceEstimates() {
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::MixStateCovarianceEstimates() {
   for(int j = 0;j<NUM_FILTERS;j++) {
     for(int i = 0;i<NUM_FILTERS;i++) {
-      StateVector xi = _filters[i].GetEstimate().first;
-      StateCovarianceMatrix Pi = _filters[i].GetEstimate().second;
-      StateVector temp = xi - _mixed[j].first;
+      IMMStateVector xi = _estimates[i].first;
+      IMMStateCovarianceMatrix Pi = _estimates[i].second;
+      Matrix<CovarianceScalar,NUM_STATES,1> temp = (xi - _mixed[j].first).template cast<CovarianceScalar>();
       _mixed[j].second += _muMix(i,j)*(Pi+temp*temp.transpose());
     }
   }
 }
 
-void IMM::GetLikelihoods(MeasurementVector z) {
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::GetLikelihoods(const ConvertedMeasurement& z) {
+  for(int i = 0;i<NUM_FILTERS;i++){
+    _filters[i]->Update(z);
+    _Lambda(i) = _filters[i]->GetLikelihood();
+  }
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::GetLikelihoods(const ConvertedScan& scan, const PDAParameters& pda) {
   for(int i = 0;i<NUM_FILTERS;i++){
-    _filters[i].Update(z);
-    _Lambda(i) = _filters[i].GetLikelihood();
+    _filters[i]->UpdatePDA(scan,pda);
+    _Lambda(i) = _filters[i]->GetLikelihood();
   }
 }
 
-void IMM::UpdateModeProbabilities() {
-  double c = 0;
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::UpdateModeProbabilities() {
+  CovarianceScalar c = 0;
   for(int j = 0;j<NUM_FILTERS;j++) {
     c += _Lambda(j)*_c(j);
   }
+  if(!(c > 0)) {//no model explains the data (all gated out, or underflow), keep the predicted mode probabilities
+    _muMode = _c;
+    return;
+  }
   for(int i = 0;i<NUM_FILTERS;i++) {
     _muMode(i) = _Lambda(i)*_c(i)/c;
   }
 }
 
-void IMM::Estimate() {
-  _x<<0,0,0,0,0;
-  _P<<0,0,0,0,0,
-  0,0,0,0,0,
-  0,0,0,0,0,
-  0,0,0,0,0,
-  0,0,0,0,0;
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Estimate() {
+  _x.setZero();
+  _P.setZero();
   for(int i = 0;i<NUM_FILTERS;i++) {
-    StateVector xi = _filters[i].GetEstimate().first;
-    _x += xi*_muMode(i);
+    _estimates[i] = _filters[i]->GetEstimate();
+    IMMStateVector xi = _estimates[i].first;
+    _x += xi*StateScalar(_muMode(i));
   }
   for(int i = 0;i<NUM_FILTERS;i++) {
-    StateVector xi = _filters[i].GetEstimate().first;
-    StateVector temp = xi - _x;
-    StateCovarianceMatrix Pi = _filters[i].GetEstimate().second;
+    IMMStateVector xi = _estimates[i].first;
+    Matrix<CovarianceScalar,NUM_STATES,1> temp = (xi - _x).template cast<CovarianceScalar>();
+    IMMStateCovarianceMatrix Pi = _estimates[i].second;
     _P += _muMode(i)*(Pi+temp*temp.transpose());
   }
 }
 
-MeasurementVector IMM::GetRealZ() {
-  return _filters[0].GetRealZ();
+template<class PrecisionPolicy>
+MeasurementVector IMM<PrecisionPolicy>::GetRealZ() {
+  return _filters[0]->GetRealZ();
+}
+
+namespace {
+const string snapshotMagic = "ETPSNAP";
+const uint32_t snapshotVersion = 1;
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::SaveState(ostream& os) const {
+  WriteBinary<uint8_t>(os,_filters.size());
+  for(int i = 0;i<NUM_FILTERS;i++) WriteBinary<CovarianceScalar>(os,_muMode(i));
+  for(auto& filter:_filters) filter->SaveState(os);
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::LoadState(istream& is) {
+  if(ReadBinary<uint8_t>(is) != _filters.size()) throw runtime_error("snapshot was taken with another model set");
+  for(int i = 0;i<NUM_FILTERS;i++) _muMode(i) = ReadBinary<CovarianceScalar>(is);
+  for(auto& filter:_filters) filter->LoadState(is);
+  Estimate();
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::WriteSnapshot(ostream& os, const vector<IMM>& tracks) {
+  os.write(snapshotMagic.data(),snapshotMagic.size());
+  WriteBinary<uint32_t>(os,snapshotVersion);
+  WriteBinary<uint8_t>(os,sizeof(StateScalar));
+  WriteBinary<uint8_t>(os,sizeof(CovarianceScalar));
+  WriteBinary<uint32_t>(os,tracks.size());
+  for(auto& track:tracks) track.SaveState(os);
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::ReadSnapshot(istream& is, vector<IMM>& tracks, const IMM& prototype) {
+  string magic(snapshotMagic.size(),'\0');
+  is.read(&magic[0],magic.size());
+  if(!is || magic != snapshotMagic || ReadBinary<uint32_t>(is) != snapshotVersion) {
+    throw runtime_error("not a track snapshot of this version");
+  }
+  if(ReadBinary<uint8_t>(is) != sizeof(StateScalar) || ReadBinary<uint8_t>(is) != sizeof(CovarianceScalar)) {
+    throw runtime_error("snapshot was taken at another precision");
+  }
+  size_t count = ReadBinary<uint32_t>(is);
+  if(tracks.size() > count) tracks.erase(tracks.begin()+count,tracks.end());
+  while(tracks.size() < count) tracks.push_back(prototype);
+  for(auto& track:tracks) track.LoadState(is);
+}
+
+template<class PrecisionPolicy>
+int IMM<PrecisionPolicy>::ColdStateSize() const {
+  int size = 0;
+  for(auto& filter:_filters) size += filter->NumStates();
+  return size;
+}
+
+template<class PrecisionPolicy>
+int IMM<PrecisionPolicy>::ColdCovarianceSize() const {
+  int size = NUM_FILTERS;
+  for(auto& filter:_filters) size += filter->NumStates()*(filter->NumStates()+1)/2;
+  return size;
+}
+
+template<class PrecisionPolicy>
+uint64_t IMM<PrecisionPolicy>::ModelFingerprint() const {
+  uint64_t hash = 14695981039346656037ull;
+  for(auto& filter:_filters) hash = (hash ^ filter->ModelFingerprint())*1099511628211ull;
+  return hash;
+}
+
+template<class PrecisionPolicy>
+template<class ColdScalar>
+void IMM<PrecisionPolicy>::FreezeTrack(StateScalar* x, ColdScalar* P) const {
+  for(int i = 0;i<NUM_FILTERS;i++) *P++ = ColdScalar(_muMode(i));
+  for(auto& filter:_filters) {
+    int n = filter->NumStates();
+    filter->Freeze(x,P);
+    x += n;
+    P += n*(n+1)/2;
+  }
+}
+
+template<class PrecisionPolicy>
+template<class ColdScalar>
+void IMM<PrecisionPolicy>::ThawTrack(const StateScalar* x, const ColdScalar* P) {
+  for(int i = 0;i<NUM_FILTERS;i++) _muMode(i) = CovarianceScalar(*P++);
+  for(auto& filter:_filters) {
+    int n = filter->NumStates();
+    filter->Thaw(x,P);
+    x += n;
+    P += n*(n+1)/2;
+  }
+  Estimate();
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Freeze(StateScalar* x, float* P) const {
+  FreezeTrack(x,P);
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Freeze(StateScalar* x, double* P) const {
+  FreezeTrack(x,P);
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Thaw(const StateScalar* x, const float* P) {
+  ThawTrack(x,P);
+}
+
+template<class PrecisionPolicy>
+void IMM<PrecisionPolicy>::Thaw(const StateScalar* x, const double* P) {
+  ThawTrack(x,P);
 }
 
-double IMM::GetNORXE(StateVector x) {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetNORXE(StateVector x) {
   double xSquig = x(0)-_x(0);
   xSquig = xSquig/sqrt(_P(0,0));
   return xSquig;
 }
 
-double IMM::GetFPOS() {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetFPOS() {
   return _P(0,0)+_P(2,2);
 }
 
-double IMM::GetFVEL() {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetFVEL() {
   return _P(1,1)+_P(3,3);
 }
 
-double IMM::GetSPOS(StateVector x) {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetSPOS(StateVector x) {
   return pow(_x(0)-x(0)+_x(2)-x(2),2);
 }
 
-double IMM::GetSVEL(StateVector x) {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetSVEL(StateVector x) {
   return pow(_x(1)-x(1)+_x(3)-x(3),2);
 }
 
-double IMM::GetSSPD(StateVector x) {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetSSPD(StateVector x) {
   double xspd = sqrt(x(1)*x(1) + x(3)*x(3));
   double _xspd = sqrt(_x(1)*_x(1) + _x(3)*_x(3));
   return pow(xspd - _xspd,2);
 }
 
-double IMM::GetSCRS(StateVector x) {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetSCRS(StateVector x) {
   double xcrs = atan2(x(3),x(1));
   double _xcrs = atan2(_x(3),_x(1));
   return pow(xcrs - _xcrs,2);
 }
 
-double IMM::GetNEES(StateVector x) {
-  StateVector xSquig = x-_x;
-  double NEES = xSquig.transpose()*_P.inverse()*xSquig;
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetNEES(StateVector x) {
+  StateVector xSquig = x-_x.template cast<DataType>();
+  double NEES = xSquig.transpose()*_P.template cast<DataType>().inverse()*xSquig;
   return NEES;
 }
 
-double IMM::GetMOD2PR() {
+template<class PrecisionPolicy>
+double IMM<PrecisionPolicy>::GetMOD2PR() {
   return _muMode(1);
 }
 
-ofstream& operator<<(ofstream& of,  const IMM& imm) {
-  IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");//Formatting for outputting Eigen matrix
-  //of << "t = "<<filter._t<<endl;
-  of <<imm._x.format(myFormat)<<endl;
-  //of << "P = "<<filter._P.format(OctaveFmt)<<endl;
-  //of << "W = "<<filter._W.format(OctaveFmt)<<endl;
-  return of;
-}
\ No newline at end of file
+template class IMM<DoublePrecision>;
+template class IMM<SinglePrecision>;
+template class IMM<MixedPrecision>;
@@ -3,128 +3,458 @@
 //
 
 #include "../include/KalmanFilter.h"
+#include "../include/BinaryIO.h"
 
-KalmanFilter::KalmanFilter(){ }
-
-KalmanFilter::KalmanFilter(StateVector sensorState,
-                          double sigmaR,
-                          double sigmaTheta,
-                          TimeType Ts,
-                          function<SystemMatrix(StateVector)> generateSystemMatrix,
-                          MeasurementCovarianceMatrix R,
-                          MeasurementMatrix H,
-                          ProcessNoiseCovarianceMatrix Q,
-                          function<StateVector(StateVector)> predictState):
-                            _sensorState(sensorState),
-                            _sigmaR(sigmaR),
-                            _sigmaTheta(sigmaTheta),
-                            _Ts(Ts),
-                            _generateSystemMatrix(generateSystemMatrix),
-                            _R(R),
-                            _H(H),
-                            _Q(Q),
-                            _predictState(predictState){
-  _validityConstant = sigmaTheta*sigmaTheta/sigmaR;
-  _initialR = _R;
-}
-
-void KalmanFilter::Initialize(MeasurementVector z0, MeasurementVector z1) {
-  z0 = ConvertToCartesian(z0);
-  z1 = ConvertToCartesian(z1);
+#include <limits>
+#include <type_traits>
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::KalmanModel(const KalmanModel& other):
+        converter(other.converter),
+        Ts(other.Ts),
+        H(other.H),
+        Q(other.Q),
+        initialR(other.initialR),
+        predictState(other.predictState),
+        generateSystemMatrix(other.generateSystemMatrix),
+        processNoiseStdDev(other.processNoiseStdDev),
+        structure(other.structure),
+        fingerprint(other.fingerprint),
+        linear(other.linear),
+        F(other.F){}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+const typename KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Transition&
+KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CoastTransition(int k) const {
+  if(!linear) throw logic_error("only a linear model has a transition over a gap");
+  if(k < 1) throw invalid_argument("a gap is at least one scan");
+  lock_guard<mutex> lock(_transitionMutex);
+  return CoastTransitionLocked(k);
+}
+
+/*Over a steps and then b: F = Fb*Fa and Q = Fb*Qa*Fb' + Qb. The map's references stay valid as it grows.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+const typename KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Transition&
+KalmanModel<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CoastTransitionLocked(int k) const {
+  auto found = _transitions.find(k);
+  if(found != _transitions.end()) return found->second;
+  Transition transition;
+  if(k == 1) transition = make_pair(F,Q.template cast<DataType>().eval());
+  else {
+    const Transition& a = CoastTransitionLocked(k/2);
+    const Transition& b = k % 2 == 0 ? a : CoastTransitionLocked(k-k/2);
+    transition.first = b.first*a.first;
+    transition.second = b.first*a.second*b.first.transpose() + b.second;
+  }
+  return _transitions.emplace(k,transition).first->second;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::KalmanFilter(){ }
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::KalmanFilter(shared_ptr<const Model> model,
+                                                                                 unsigned seed):
+                                                                                 _model(model){
+  for(int i = 0;i<NProcessNoises;i++) {
+    _noise[i] = normal_distribution<double>(0,_model->processNoiseStdDev(i));
+  }
+  Reset(seed);
+  if(_model->structure == CovarianceStructure::AxisBlocks && NStates != CV_STATES) {
+    throw invalid_argument("axis blocks are the (x, xDot), (y, yDot) pairs of a 4 state model");
+  }
+  if(_model->structure == CovarianceStructure::TurnRateColumn && NStates != CT_STATES) {
+    throw invalid_argument("the turn rate column kernel is laid out for the 5 state CT model");
+  }
+}
+
+/*Everything an update leaves behind is overwritten by Initialize and the next update, so only the run counters and the
+ * noise streams need restoring*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Reset(unsigned seed, bool antithetic) {
+  mt19937 seeder(seed);
+  for(int i = 0;i<NProcessNoises;i++) {
+    _noiseGenerators[i].seed(seeder());
+    _noise[i].reset();
+  }
+  _antithetic = antithetic;
+  _t = 0;
+  _pdaLikelihood = -1;
+  _R = _model->initialR;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::DrawProcessNoise() {
+  for(int i = 0;i<NProcessNoises;i++) _processNoise(i) = _noise[i](_noiseGenerators[i]);
+  if(_antithetic) _processNoise = -_processNoise;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Initialize(MeasurementVector z0, MeasurementVector z1) {
+  Initialize(_model->converter.Convert(z0),_model->converter.Convert(z1));
+}
+
+/*Two point differencing, the covariance is the second measurement's*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Initialize(const ConvertedMeasurement& converted0,
+                                                                                    const ConvertedMeasurement& converted1) {
+  MeasurementVector z0 = converted0.z, z1 = converted1.z;
+  TimeType Ts = _model->Ts;
+  _R = converted1.R.template cast<CovarianceScalar>();
+  _x = ModelStateVector::Zero();//omega and the accelerations start at 0
   _x(0) = z1(0);//x position
-  double xDot = (z1(0)-z0(0))/_Ts;
+  double xDot = (z1(0)-z0(0))/Ts;
   _x(1) = xDot; //x speed
   _x(2) = z1(1);//y position
-  double yDot = (z1(1)-z0(1))/_Ts;
+  double yDot = (z1(1)-z0(1))/Ts;
   _x(3) = yDot;//y speed
-  _x(4) = 0;//omega
   double Rx = _R(0,0);
   double Ry = _R(1,1);
-  _P<< Rx,     Rx/_Ts,         0,      0,              0,
-       Rx/_Ts, 2*Rx/(_Ts*_Ts), 0,      0,              0,
-       0,      0,              Ry,     Ry/_Ts,         0,
-       0,      0,              Ry/_Ts, 2*Ry/(_Ts*_Ts), 0,
-       0,      0,              0,      0,              Rx;
+  _P = ModelStateCovarianceMatrix::Zero();
+  _P.template topLeftCorner<4,4>()<< Rx,    Rx/Ts,        0,     0,
+                                     Rx/Ts, 2*Rx/(Ts*Ts), 0,     0,
+                                     0,     0,            Ry,    Ry/Ts,
+                                     0,     0,            Ry/Ts, 2*Ry/(Ts*Ts);
+  for(int i = 4;i<NStates;i++) _P(i,i) = Rx;//uninformative for the states two points can't observe
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CommonEstimate KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Update(MeasurementVector measurement) {
+  return Update(_model->converter.Convert(measurement));
 }
 
-pair<StateVector,StateCovarianceMatrix> KalmanFilter::Update(MeasurementVector measurement) {
-  measurement = ConvertToCartesian(measurement);
-  _zReal = measurement;
-  _F = _generateSystemMatrix(_x);
+/*The conversion is always done in DataType, only the results are stored at the filter's precision*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CommonEstimate KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Update(const ConvertedMeasurement& measurement) {
+  _zReal = measurement.z;
+  _R = measurement.R.template cast<CovarianceScalar>();
+  _pdaLikelihood = -1;
+  _F = _model->generateSystemMatrix(_x);
   UpdateCovarianceAndGain();
-  UpdateStateEstimate(measurement);
-  pair<StateVector, StateCovarianceMatrix> estimates = make_pair(_x,_P);
+  UpdateStateEstimate(measurement.z.template cast<StateScalar>());
   _t++;
-  return estimates;
-}
-
-MeasurementVector KalmanFilter::ConvertToCartesian(MeasurementVector z) {
-  MeasurementVector z1;
-  double r = z(0), theta = z(1);
-  double s = sin(theta), c = cos(theta), c2 = cos(2*theta), s2 = sin(2*theta);
-  double sigRSquared = _sigmaR*_sigmaR, sigThetaSquared = _sigmaTheta*_sigmaTheta;
-  if((r*_validityConstant)>0.4) {//debiasing
-    double b1 = exp(-(_sigmaTheta*_sigmaTheta)/2);
-    double b2 = b1*b1*b1*b1;
-    z1(0) = r*cos(theta)/b1 + _sensorState(0);
-    z1(1) = r*sin(theta)/b1 + _sensorState(2);
-    _R(0,0) = (1/(b1*b1) -2)*r*r*c*c + (r*r + sigRSquared)*.5*(1+b2*c2);
-    _R(1,1) = (1/(b1*b1) -2)*r*r*s*s + (r*r + sigRSquared)*.5*(1-b2*c2);
-    _R(0,1) = _R(1,0) = (r*r/(2*b1*b1) + (r*r + sigRSquared)*b2/2 - r*r)*s2;
+  return GetEstimate();
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+const MeasurementConverter& KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetConverter() const {
+  return _model->converter;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+const shared_ptr<const typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Model>&
+KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetModel() const {
+  return _model;
+}
+
+/*PDAF. Every return is weighed with its own conversion covariance, as Update would take it, so S_i = R_i + H*P*H'
+ * is a 2x2 per return, gated with a box test on its gate ellipse's extent and, if inside, factored for the distance.
+ * Only validated returns reach the association weights. All hypotheses share P*H', so the moment matched mixture of
+ * the no-detection hypothesis and one per validated return (Bar-Shalom & Li) only needs 2x2 sums of S_i^-1 and
+ * S_i^-1*v_i. Without clutter there is nothing to gate out, and a single return is Update's.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CommonEstimate KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::UpdatePDA(const ConvertedScan& scan, const PDAParameters& pda) {
+  _F = _model->generateSystemMatrix(_x);
+  PropagateCovariance();
+  DrawProcessNoise();
+  _x = _model->predictState(_x,_processNoise);
+  _z = _model->H.template cast<StateScalar>()*_x;
+  MeasurementVector zPredicted = _z.template cast<DataType>();
+  const ModelMeasurementMatrix& H = _model->H;
+  Matrix<CovarianceScalar,NStates,NMeasurements> PHt = _P*H.transpose();
+  MeasurementCovarianceMatrix HPHt = (H*PHt).template cast<DataType>();
+
+  double gamma = pda.clutterDensity > 0 ? pda.Gamma() : numeric_limits<double>::infinity();
+  double sumE = 0, bestE = -1;
+  int m = 0;
+  MeasurementVector sumEv = MeasurementVector::Zero(), sumEu = MeasurementVector::Zero();//u = S_i^-1*v_i
+  MeasurementCovarianceMatrix sumESinv = MeasurementCovarianceMatrix::Zero(), sumEuu = MeasurementCovarianceMatrix::Zero();
+  _zReal = zPredicted;
+  for(Index i = 0;i<scan.x.size();i++) {
+    double vx = scan.x(i)-zPredicted(0), vy = scan.y(i)-zPredicted(1);
+    MeasurementCovarianceMatrix R;
+    R << scan.Rxx(i), scan.Rxy(i),
+         scan.Rxy(i), scan.Ryy(i);
+    MeasurementCovarianceMatrix S = HPHt + R;
+    if(vx*vx > gamma*S(0,0) || vy*vy > gamma*S(1,1)) continue;
+    double l00 = sqrt(S(0,0)), l10 = S(1,0)/l00, l11 = sqrt(S(1,1)-l10*l10);//Cholesky of the 2x2 S
+    double u0 = vx/l00, u1 = (vy-l10*u0)/l11, d2 = u0*u0+u1*u1;
+    if(d2 > gamma) continue;
+    double e = exp(-0.5*d2)/(2*M_PI*l00*l11);//N(v;0,S), as GetLikelihood
+    MeasurementCovarianceMatrix Sinv = S.inverse();
+    MeasurementVector v(vx,vy), u = Sinv*v;
+    m++;
+    sumE += e;
+    sumEv += e*v;
+    sumESinv += e*Sinv;
+    sumEu += e*u;
+    sumEuu += e*u*u.transpose();
+    if(e > bestE) {
+      bestE = e;
+      _zReal << scan.x(i), scan.y(i);
+      _R = R.template cast<CovarianceScalar>();
+    }
   }
-  else {
-    z1(0) = r * cos(theta) + _sensorState(0);
-    z1(1) = r * sin(theta) + _sensorState(2);
-    _R(0,0) = r*r*sigThetaSquared*s*s + sigRSquared*c*c;
-    _R(1,1) = r*r*sigThetaSquared*c*c + sigRSquared*s*s;
-    _R(0,1) = _R(1,0) = (sigRSquared-r*r*sigThetaSquared)*s*c;
+  _S = _R + H*PHt;
+  double lambda = pda.clutterDensity/max(_model->converter.ToPolar(zPredicted)(0),1.0);//Cartesian clutter density at the prediction
+  double b = lambda*(1-pda.Pd*pda.Pg)/pda.Pd;
+  _pdaLikelihood = lambda*(1-pda.Pd*pda.Pg) + pda.Pd*sumE;
+  if(m == 0 || !(b+sumE > 0)) {//nothing validated, the prediction stands
+    _v.setZero();
+    _t++;
+    return GetEstimate();
+  }
+  /*x += P*H'*sum(beta_i*u_i), P += P*H'*(sum(beta_i*(u_i*u_i' - S_i^-1)) - a*a')*H*P with a the combined u*/
+  double c = b+sumE;
+  MeasurementVector a = sumEu/c;
+  MeasurementCovarianceMatrix spread = (sumEuu-sumESinv)/c - a*a.transpose();
+  _P = _P + PHt*spread.template cast<CovarianceScalar>()*PHt.transpose();
+  _P = CovarianceScalar(.5)*(_P + _P.transpose()).eval();
+  _v = (sumEv/c).template cast<StateScalar>();//combined innovation
+  _x = _x + (PHt.template cast<DataType>()*a).template cast<StateScalar>();
+  _t++;
+  return GetEstimate();
+}
+
+/*k scans without a detection. A linear model jumps over the gap with its cached F^k and accumulated Q; the EKF
+ * relinearizes about its prediction at every scan, so it still takes k steps. Only the mean is predicted, no process
+ * noise is drawn, and the last measurement covariance is kept for the next update's gate.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CommonEstimate KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Coast(int k) {
+  if(k < 0) throw invalid_argument("can't coast backwards");
+  if(k == 0) return GetEstimate();
+  if(_model->linear) {
+    const typename Model::Transition& transition = _model->CoastTransition(k);
+    const Matrix<DataType,NStates,NStates>& Fk = transition.first;
+    _x = Fk.template cast<StateScalar>()*_x;
+    _P = (Fk*_P.template cast<DataType>()*Fk.transpose() + transition.second).template cast<CovarianceScalar>();
   }
-  return z1;
+  else for(int i = 0;i<k;i++) {
+    _F = _model->generateSystemMatrix(_x);
+    PropagateCovariance();
+    _x = _model->predictState(_x,ModelProcessNoiseVector::Zero());
+  }
+  _v.setZero();
+  _pdaLikelihood = -1;
+  _t += k;
+  return GetEstimate();
+}
+
+/*The Riccati recursion runs at CovarianceScalar, the gain is handed to the state update at StateScalar*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::UpdateCovarianceAndGain() {
+  PropagateCovariance();
+  const ModelMeasurementMatrix& H = _model->H;
+  _S = _R + H*_P*H.transpose();//measurement prediction covariance
+  Matrix<CovarianceScalar,NStates,NMeasurements> W = _P*H.transpose()*_S.inverse();//gain matrix
+  _P = _P - W*_S*W.transpose();
+  _P = CovarianceScalar(.5)*(_P + _P.transpose()).eval();//the subtraction cancels badly once R is small
+  _W = W.template cast<StateScalar>();
+}
+
+namespace {
+/*The update couples the axes through R, so P is dense even when F isn't. With F = diag(Fx, Fy) each 2x2 block of P
+ * is Fi*Pij*Fj'. In the CT Jacobian the position columns are unit vectors and the omega row is e5', so F*P only needs
+ * the velocity and omega rows of P mixed into rows 0-3, and (F*P)*F' the same for columns. P is only symmetric to
+ * rounding after an update; every block is propagated, so the result is F*P*F' whatever P is.
+ * Each kernel only exists for the layout it's written for, the other dimensions get an empty overload (the
+ * constructor rejects those models).*/
+template<class SystemMatrix, class CovarianceMatrix>
+void PropagateAxisBlocks(const SystemMatrix&, CovarianceMatrix&, false_type) { }
+
+template<class SystemMatrix, class CovarianceMatrix>
+void PropagateAxisBlocks(const SystemMatrix& F, CovarianceMatrix& P, true_type) {
+  typedef typename CovarianceMatrix::Scalar CovarianceScalar;
+  Matrix<CovarianceScalar,2,2> Fx = F.template block<2,2>(0,0), Fy = F.template block<2,2>(2,2);
+  Matrix<CovarianceScalar,2,2> Pxx = Fx*P.template block<2,2>(0,0)*Fx.transpose();
+  Matrix<CovarianceScalar,2,2> Pxy = Fx*P.template block<2,2>(0,2)*Fy.transpose();
+  Matrix<CovarianceScalar,2,2> Pyx = Fy*P.template block<2,2>(2,0)*Fx.transpose();
+  Matrix<CovarianceScalar,2,2> Pyy = Fy*P.template block<2,2>(2,2)*Fy.transpose();
+  P.template block<2,2>(0,0) = Pxx;
+  P.template block<2,2>(0,2) = Pxy;
+  P.template block<2,2>(2,0) = Pyx;
+  P.template block<2,2>(2,2) = Pyy;
+}
+
+template<class SystemMatrix, class CovarianceMatrix>
+void PropagateTurnRateColumn(const SystemMatrix&, CovarianceMatrix&, false_type) { }
+
+template<class SystemMatrix, class CovarianceMatrix>
+void PropagateTurnRateColumn(const SystemMatrix& F, CovarianceMatrix& P, true_type) {
+  typedef typename CovarianceMatrix::Scalar CovarianceScalar;
+  CovarianceScalar FP[CT_STATES][CT_STATES];//F*P, row 4 is P's
+  for(int j = 0;j<CT_STATES;j++) {
+    CovarianceScalar p1 = P(1,j), p3 = P(3,j), p4 = P(4,j);
+    FP[0][j] = P(0,j) + F(0,1)*p1 + F(0,3)*p3 + F(0,4)*p4;
+    FP[1][j] = F(1,1)*p1 + F(1,3)*p3 + F(1,4)*p4;
+    FP[2][j] = P(2,j) + F(2,1)*p1 + F(2,3)*p3 + F(2,4)*p4;
+    FP[3][j] = F(3,1)*p1 + F(3,3)*p3 + F(3,4)*p4;
+    FP[4][j] = p4;
+  }
+  for(int i = 0;i<CT_STATES;i++) {
+    CovarianceScalar a0 = FP[i][0], a1 = FP[i][1], a2 = FP[i][2], a3 = FP[i][3], a4 = FP[i][4];
+    P(i,0) = a0 + a1*F(0,1) + a3*F(0,3) + a4*F(0,4);
+    P(i,1) = a1*F(1,1) + a3*F(1,3) + a4*F(1,4);
+    P(i,2) = a2 + a1*F(2,1) + a3*F(2,3) + a4*F(2,4);
+    P(i,3) = a1*F(3,1) + a3*F(3,3) + a4*F(3,4);
+    P(i,4) = a4;
+  }
+}
 }
 
-void KalmanFilter::UpdateCovarianceAndGain() {
-  _P = _F*_P*_F.transpose()+_Q;
-  _S = _R + _H*_P*_H.transpose();//measurement prediction covariance
-  _W = _P*_H.transpose()*_S.inverse();//gain matrix
-  _P = _P - _W*_S*_W.transpose();
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::PropagateCovariance() {
+  switch(_model->structure) {
+    case CovarianceStructure::AxisBlocks:
+      PropagateAxisBlocks(_F,_P,integral_constant<bool,NStates == CV_STATES>());
+      break;
+    case CovarianceStructure::TurnRateColumn:
+      PropagateTurnRateColumn(_F,_P,integral_constant<bool,NStates == CT_STATES>());
+      break;
+    default:
+      _P = _F*_P*_F.transpose();
+  }
+  _P += _model->Q;
 }
 
-void KalmanFilter::UpdateStateEstimate(MeasurementVector z) {
-  _x = _predictState(_x);
-  _z = _H*_x;
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::UpdateStateEstimate(ModelMeasurementVector z) {
+  DrawProcessNoise();
+  _x = _model->predictState(_x,_processNoise);
+  _z = _model->H.template cast<StateScalar>()*_x;
   _v = z - _z;//actual measurement less predicted
   _x = _x + _W*_v;
 }
 
-pair<StateVector,StateCovarianceMatrix> KalmanFilter::GetEstimate() {
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::CommonEstimate KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetEstimate() {
+  return EmbedState<NStates>(_x,_P);
+};
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+pair<typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ModelStateVector,
+     typename KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ModelStateCovarianceMatrix>
+KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetModelEstimate() {
   return make_pair(_x,_P);
 };
 
-void KalmanFilter::Reinitialize(pair<StateVector,StateCovarianceMatrix> params) {
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Reinitialize(CommonEstimate params) {
+  ProjectState<NStates>(params,_x,_P);
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ReinitializeModel(pair<ModelStateVector,ModelStateCovarianceMatrix> params) {
   _x = params.first;
   _P = params.second;
 }
 
-double KalmanFilter::GetLikelihood() {
-  MeasurementCovarianceMatrix tempMatrix = 2.0*3.14159265358979*_S;//
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+double KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetLikelihood() {
+  if(_pdaLikelihood >= 0) return _pdaLikelihood;
+  ModelMeasurementCovarianceMatrix tempMatrix = CovarianceScalar(2.0*3.14159265358979)*_S;//
   double exponent;
-  exponent = _v.transpose()*_S.inverse()*_v;
-  double Lambda = exp(-0.5*exponent);//sqrt(tempMatrix.determinant());
+  Matrix<CovarianceScalar,NMeasurements,1> v = _v.template cast<CovarianceScalar>();
+  exponent = (v.transpose()*_S.inverse()*v).value();
+  double Lambda = exp(-0.5*exponent)/sqrt(double(tempMatrix.determinant()));//N(v;0,S), the density UpdatePDA mixes with clutter
   return Lambda;
 }
 
-MeasurementVector KalmanFilter::GetRealZ() {
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+MeasurementVector KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::GetRealZ() {
   return _zReal;
 }
 
-ofstream& operator<<(ofstream& of,  const KalmanFilter& filter) {
-  IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");//Formatting for outputting Eigen matrix
-  //of << "t = "<<filter._t<<endl;
-  of <<filter._x.format(myFormat)<<endl;
-  //of << "P = "<<filter._P.format(OctaveFmt)<<endl;
-  //of << "W = "<<filter._W.format(OctaveFmt)<<endl;
-  return of;
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+unique_ptr<ModeFilter<PrecisionPolicy>> KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Clone() const {
+  return unique_ptr<ModeFilter<PrecisionPolicy>>(new KalmanFilter(*this));
 }
 
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::SaveState(ostream& os) const {
+  WriteBinary<uint64_t>(os,_model->fingerprint);
+  WriteBinary<int32_t>(os,int32_t(_t));
+  for(int i = 0;i<NStates;i++) WriteBinary<StateScalar>(os,_x(i));
+  for(int i = 0;i<NStates;i++) for(int j = i;j<NStates;j++) WriteBinary<CovarianceScalar>(os,_P(i,j));
+  WriteBinary<double>(os,_zReal(0));
+  WriteBinary<double>(os,_zReal(1));
+}
 
+/*Only what the next update reads is restored, the rest is rebuilt by it*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::LoadState(istream& is) {
+  if(ReadBinary<uint64_t>(is) != _model->fingerprint) throw runtime_error("snapshot was taken with another model");
+  _t = ReadBinary<int32_t>(is);
+  for(int i = 0;i<NStates;i++) _x(i) = ReadBinary<StateScalar>(is);
+  for(int i = 0;i<NStates;i++) for(int j = i;j<NStates;j++) _P(i,j) = _P(j,i) = ReadBinary<CovarianceScalar>(is);
+  _zReal(0) = ReadBinary<double>(is);
+  _zReal(1) = ReadBinary<double>(is);
+  _v.setZero();
+  _pdaLikelihood = -1;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+int KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::NumStates() const {
+  return NStates;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+uint64_t KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ModelFingerprint() const {
+  return _model->fingerprint;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+template<class ColdScalar>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::FreezeTrack(StateScalar* x, ColdScalar* P) const {
+  for(int i = 0;i<NStates;i++) x[i] = _x(i);
+  for(int i = 0;i<NStates;i++) for(int j = i;j<NStates;j++) *P++ = ColdScalar(_P(i,j));
+}
+
+/*Like LoadState, only what the next update reads. The time index stays, nothing reads it.*/
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+template<class ColdScalar>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::ThawTrack(const StateScalar* x, const ColdScalar* P) {
+  for(int i = 0;i<NStates;i++) _x(i) = x[i];
+  for(int i = 0;i<NStates;i++) for(int j = i;j<NStates;j++) _P(i,j) = _P(j,i) = CovarianceScalar(*P++);
+  _v.setZero();
+  _pdaLikelihood = -1;
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Freeze(StateScalar* x, float* P) const {
+  FreezeTrack(x,P);
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Freeze(StateScalar* x, double* P) const {
+  FreezeTrack(x,P);
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Thaw(const StateScalar* x, const float* P) {
+  ThawTrack(x,P);
+}
+
+template<int NStates, int NMeasurements, int NProcessNoises, class PrecisionPolicy>
+void KalmanFilter<NStates,NMeasurements,NProcessNoises,PrecisionPolicy>::Thaw(const StateScalar* x, const double* P) {
+  ThawTrack(x,P);
+}
 
+template struct KalmanModel<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, DoublePrecision>;
+template struct KalmanModel<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, DoublePrecision>;
+template struct KalmanModel<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, DoublePrecision>;
+template struct KalmanModel<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, SinglePrecision>;
+template struct KalmanModel<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, SinglePrecision>;
+template struct KalmanModel<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, SinglePrecision>;
+template struct KalmanModel<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, MixedPrecision>;
+template struct KalmanModel<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, MixedPrecision>;
+template struct KalmanModel<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, MixedPrecision>;
+template class KalmanFilter<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, DoublePrecision>;
+template class KalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, DoublePrecision>;
+template class KalmanFilter<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, DoublePrecision>;
+template class KalmanFilter<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, SinglePrecision>;
+template class KalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, SinglePrecision>;
+template class KalmanFilter<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, SinglePrecision>;
+template class KalmanFilter<CV_STATES, NUM_MEASUREMENTS, CV_PROCESS_NOISES, MixedPrecision>;
+template class KalmanFilter<CT_STATES, NUM_MEASUREMENTS, CT_PROCESS_NOISES, MixedPrecision>;
+template class KalmanFilter<CA_STATES, NUM_MEASUREMENTS, CA_PROCESS_NOISES, MixedPrecision>;
@@ -0,0 +1,112 @@
+//
+// Created by clancy on 5/13/16.
+//
+
+#include "../include/MeasurementConverter.h"
+
+MeasurementConverter::MeasurementConverter():MeasurementConverter(StateVector::Zero(),1,0) { }
+
+MeasurementConverter::MeasurementConverter(StateVector sensorState, double sigmaR, double sigmaTheta):
+        _sensorState(sensorState),
+        _sigmaR(sigmaR),
+        _sigmaTheta(sigmaTheta){
+  _validityConstant = sigmaTheta*sigmaTheta/sigmaR;
+  _b1 = exp(-(_sigmaTheta*_sigmaTheta)/2);
+  _b2 = _b1*_b1*_b1*_b1;
+}
+
+ConvertedMeasurement MeasurementConverter::Convert(MeasurementVector z) const {
+  ConvertedMeasurement converted;
+  converted.polar = z;
+  MeasurementVector& z1 = converted.z;
+  MeasurementCovarianceMatrix& R = converted.R;
+  double r = z(0), theta = z(1);
+  double s = sin(theta), c = cos(theta);
+  double sigRSquared = _sigmaR*_sigmaR, sigThetaSquared = _sigmaTheta*_sigmaTheta;
+  if((r*_validityConstant)>0.4) {//debiasing
+    double c2 = cos(2*theta), s2 = sin(2*theta);
+    z1(0) = r*c/_b1 + _sensorState(0);
+    z1(1) = r*s/_b1 + _sensorState(2);
+    R(0,0) = (1/(_b1*_b1) -2)*r*r*c*c + (r*r + sigRSquared)*.5*(1+_b2*c2);
+    R(1,1) = (1/(_b1*_b1) -2)*r*r*s*s + (r*r + sigRSquared)*.5*(1-_b2*c2);
+    R(0,1) = R(1,0) = (r*r/(2*_b1*_b1) + (r*r + sigRSquared)*_b2/2 - r*r)*s2;
+  }
+  else {
+    z1(0) = r * c + _sensorState(0);
+    z1(1) = r * s + _sensorState(2);
+    R(0,0) = r*r*sigThetaSquared*s*s + sigRSquared*c*c;
+    R(1,1) = r*r*sigThetaSquared*c*c + sigRSquared*s*s;
+    R(0,1) = R(1,0) = (sigRSquared-r*r*sigThetaSquared)*s*c;
+  }
+  return converted;
+}
+
+MeasurementVector MeasurementConverter::ToPolar(MeasurementVector z) const {
+  double dx = z(0)-_sensorState(0), dy = z(1)-_sensorState(2);
+  MeasurementVector polar;
+  polar << sqrt(dx*dx+dy*dy), atan2(dy,dx);
+  return polar;
+}
+
+/*sin and cos of theta once per measurement (GCC and Clang fuse the pair into one sincos at -O2), sin(2 theta) = 2sc
+ * and cos(2 theta) = c^2-s^2, and exp() was hoisted into the constructor, so a debiased measurement costs one
+ * transcendental call instead of five*/
+void MeasurementConverter::ConvertBatch(const Column& r, const Column& theta,
+                                        Column& x, Column& y, Column& Rxx, Column& Ryy, Column& Rxy) const {
+  Index n = r.size();
+  x.resize(n);
+  y.resize(n);
+  Rxx.resize(n);
+  Ryy.resize(n);
+  Rxy.resize(n);
+  double sigRSquared = _sigmaR*_sigmaR, sigThetaSquared = _sigmaTheta*_sigmaTheta;
+  double k = 1/(_b1*_b1) - 2, inverseB1 = 1/_b1;
+  for(Index i = 0;i<n;i++) {
+    double s = sin(theta(i)), c = cos(theta(i));
+    double rr = r(i)*r(i), cc = c*c, ss = s*s, sc = s*c;
+    if(r(i)*_validityConstant > 0.4) {//debiasing
+      double c2 = cc - ss, half = (rr + sigRSquared)*.5;
+      x(i) = r(i)*c*inverseB1 + _sensorState(0);
+      y(i) = r(i)*s*inverseB1 + _sensorState(2);
+      Rxx(i) = k*rr*cc + half*(1+_b2*c2);
+      Ryy(i) = k*rr*ss + half*(1-_b2*c2);
+      Rxy(i) = (rr/(2*_b1*_b1) + half*_b2 - rr)*2*sc;
+    }
+    else {
+      x(i) = r(i)*c + _sensorState(0);
+      y(i) = r(i)*s + _sensorState(2);
+      Rxx(i) = rr*sigThetaSquared*ss + sigRSquared*cc;
+      Ryy(i) = rr*sigThetaSquared*cc + sigRSquared*ss;
+      Rxy(i) = (sigRSquared - rr*sigThetaSquared)*sc;
+    }
+  }
+}
+
+vector<ConvertedMeasurement> MeasurementConverter::ConvertBatch(const vector<MeasurementVector>& z) const {
+  Index n = z.size();
+  Column r(n), theta(n), x, y, Rxx, Ryy, Rxy;
+  for(Index i = 0;i<n;i++) {
+    r(i) = z[i](0);
+    theta(i) = z[i](1);
+  }
+  ConvertBatch(r,theta,x,y,Rxx,Ryy,Rxy);
+  vector<ConvertedMeasurement> converted(n);
+  for(Index i = 0;i<n;i++) {
+    converted[i].polar = z[i];
+    converted[i].z << x(i), y(i);
+    converted[i].R << Rxx(i), Rxy(i),
+                      Rxy(i), Ryy(i);
+  }
+  return converted;
+}
+
+void MeasurementConverter::ConvertScan(const vector<MeasurementVector>& z, ConvertedScan& scan) const {
+  Index n = z.size();
+  Column r(n), theta(n);
+  for(Index i = 0;i<n;i++) {
+    r(i) = z[i](0);
+    theta(i) = z[i](1);
+  }
+  scan.polar = z;
+  ConvertBatch(r,theta,scan.x,scan.y,scan.Rxx,scan.Ryy,scan.Rxy);
+}
@@ -0,0 +1,519 @@
+//
+// Created by clancy on 5/9/16.
+//
+
+#include "../include/MonteCarloStudy.h"
+#include "../include/IMM.h"
+#include "../include/MotionModels.h"
+#include "../include/ParticleFilter.h"
+#include "../include/Target.h"
+#include "../include/BinaryIO.h"
+#include "../include/ClutterSensor.h"
+#include "../include/SPSCQueue.h"
+#include "../include/ResultsStore.h"
+#include "../include/ResultCache.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+const string checkpointMagic = "ETPCKPT";
+const uint32_t checkpointVersion = 7;
+
+/*The study hash tells shards of different studies apart, the settings are what a merge rebuilds the study from*/
+struct CheckpointHeader {
+  unsigned seed;
+  uint64_t study;
+  string trajectoryFile;
+  string settings;//WriteStudySettings
+  int firstTrial, trial;
+};
+
+string StudySettings(const StudyConfiguration& config) {
+  ostringstream settings;
+  WriteStudySettings(settings,config);
+  return settings.str();
+}
+
+CheckpointHeader ReadCheckpointHeader(istream& in, const string& filename) {
+  string magic(checkpointMagic.size(),'\0');
+  in.read(&magic[0],magic.size());
+  if(!in || magic != checkpointMagic || ReadBinary<uint32_t>(in) != checkpointVersion) {
+    throw runtime_error(filename + " is not a checkpoint of this version");
+  }
+  CheckpointHeader header;
+  header.seed = ReadBinary<uint32_t>(in);
+  header.study = ReadBinary<uint64_t>(in);
+  header.trajectoryFile = ReadString(in);
+  header.settings = ReadString(in);
+  header.firstTrial = ReadBinary<int32_t>(in);
+  header.trial = ReadBinary<int32_t>(in);
+  return header;
+}
+
+/*The RMS over the run is the root of the mean of the per trial mean squared errors, its half-width follows from the
+ * mean's by the delta method*/
+pair<double,double> RMSInterval(pair<double,double> meanSquare) {
+  double rms = sqrt(meanSquare.first);
+  return make_pair(rms,meanSquare.second/(2*rms));
+}
+
+string ToString(double value) {
+  ostringstream text;
+  text.precision(17);
+  text<<value;
+  return text.str();
+}
+
+/*Pipelined trials: the truth+sensor stage fans every sample out to one queue per filter stage, each filter stage
+ * hands its estimates to the evaluation stage on its own queue. Every queue has one producer and one consumer and
+ * every stage handles the steps in order, so the results are exactly those of the sequential loop.*/
+struct SensorSample {
+  ConvertedMeasurement z;
+  StateVector truth;
+};
+
+struct FilterOutput {
+  StateVector x;
+  StateCovarianceMatrix P;
+  double MOD2PR;
+  MeasurementVector zReal;
+  StateVector truth;
+};
+
+typedef SPSCQueue<SensorSample,64> SampleQueue;
+typedef SPSCQueue<FilterOutput,64> OutputQueue;
+
+double ModeProbability(IMM<>& imm) { return imm.GetMOD2PR(); }
+double ModeProbability(CVKalmanFilter<>&) { return 0; }
+double ModeProbability(ParticleFilter& pf) { return pf.GetMOD2PR(); }
+
+template<class Filter>
+void FilterStage(Filter& filter, SampleQueue& in, OutputQueue& out, int steps) {
+  SensorSample sample;
+  FilterOutput output;
+  for(int i = 0;i<steps;i++) {
+    in.Pop(sample);
+    auto estimate = filter.Update(sample.z);
+    output.x = estimate.first;
+    output.P = estimate.second;
+    output.MOD2PR = ModeProbability(filter);
+    output.zReal = filter.GetRealZ();
+    output.truth = sample.truth;
+    out.Push(output);
+  }
+}
+}
+
+MonteCarloStudy::MonteCarloStudy(StudyConfiguration config):
+        _config(config),
+        _kf(setupCVKalmanFilter(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0)),
+        _immCT(setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),
+               setupCTExtendedKalmanFilter(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,0)),
+        _immL(setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),
+              setupCVKalmanFilter(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0)),
+        _range(config.sensorState,0,config.sigmaR),//std dev
+        _azimuth(config.sensorState,0,config.sigmaTheta),//std dev, 1 deg in radians
+        _shadow(config.sensorState,config.sigmaR,config.sigmaTheta,config.Ts,config.V2),
+        _fusion(config.fusionGate),
+        _firstTrial(config.firstTrial),
+        _trial(config.firstTrial){
+
+  string performancePath = _config.path+"Performance Data/";
+  _peIMMCT.SetFilePath(performancePath+"immCT/");
+  _peIMML.SetFilePath(performancePath+"immL/");
+  _peKF.SetFilePath(performancePath+"kf/");
+  _PEs.push_back(&_peIMMCT);
+  _PEs.push_back(&_peIMML);
+  _PEs.push_back(&_peKF);
+  _peNames = {"immCT","immL","kf"};
+  if(_config.runParticleFilter) {
+    _pePF.SetFilePath(performancePath+"pf/");
+    _PEs.push_back(&_pePF);
+    _peNames.push_back("pf");
+  }
+  if(_config.distributed) {
+    for(auto& site:_config.network) {
+      _nodes.push_back(IMM<>(setupCVKalmanFilter(site.sensorState,config.Ts,config.V1,site.sigmaR,site.sigmaTheta,0),
+                             setupCTExtendedKalmanFilter(site.sensorState,config.Ts,config.V3,site.sigmaR,site.sigmaTheta,0)));
+    }
+    _peT2T.SetFilePath(performancePath+"t2t/");
+    _PEs.push_back(&_peT2T);
+    _peNames.push_back("t2t");
+  }
+  for(auto pe:_PEs) pe->SetPairedRuns(_config.antithetic);
+}
+
+void MonteCarloStudy::Run() {
+  int endTrial = _config.firstTrial + _config.numTrials;
+  while(_trial < endTrial && !TargetsMet()) {
+    RunTrial(_trial);
+    _trial++;
+    if(_config.antithetic && (_trial-_firstTrial) % 2 != 0) continue;//only whole pairs are checkpointed
+    if(!_config.checkpointFile.empty() &&
+       ((_trial-_firstTrial) % _config.checkpointInterval < (_config.antithetic ? 2 : 1) || _trial == endTrial ||
+        TargetsMet())) {
+      SaveCheckpoint(_config.checkpointFile);
+    }
+  }
+}
+
+/*Checked after every trial, the running statistics make that a handful of flops per filter. A NaN interval (a
+ * diverged trial) never meets a target.*/
+bool MonteCarloStudy::TargetsMet() {
+  if(!_config.Adaptive() || GetCompletedTrials() < max(2,_config.minTrials)) return false;
+  if(_config.antithetic && GetCompletedTrials() % 2 != 0) return false;
+  for(auto pe:_PEs) {
+    double rmsHalfWidth = RMSInterval(TrialInterval(*pe,"RMSPOS")).second;
+    double aneesHalfWidth = TrialInterval(*pe,"NEES").second;
+    if(_config.targetRMSPOS > 0 && !(rmsHalfWidth <= _config.targetRMSPOS)) return false;
+    if(_config.targetANEES > 0 && !(aneesHalfWidth <= _config.targetANEES)) return false;
+  }
+  return true;
+}
+
+pair<double,double> MonteCarloStudy::TrialInterval(PerformanceEvaluator& pe, string key) {
+  if(_config.controlVariates) {
+    const ControlledStatistics& statistics = pe.GetControlledStatistics(key);
+    return make_pair(statistics.Mean(),statistics.HalfWidth(_config.confidence));
+  }
+  const RunningStatistics& statistics = pe.GetTrialStatistics(key);
+  return make_pair(statistics.Mean(),statistics.HalfWidth(_config.confidence));
+}
+
+void MonteCarloStudy::RunTrial(int trial) {
+  StateVector sensorState = _config.sensorState;
+  double sigmaR = _config.sigmaR, sigmaTheta = _config.sigmaTheta;
+  TimeType Ts = _config.Ts;
+  string path = _config.path;
+  StateVector x;
+  bool mirrored = _config.antithetic && trial % 2 != 0;//the second trial of a pair mirrors the first's noise
+  unsigned seedTrial = mirrored ? trial-1 : trial;
+  array<uint32_t,6> streamSeeds = TrialStreamSeeds(_config.seed,seedTrial);
+  _range.Seed(streamSeeds[0],mirrored);
+  _azimuth.Seed(streamSeeds[1],mirrored);
+  unsigned kf1Seed = streamSeeds[2], kf2Seed = streamSeeds[3], ekf1Seed = streamSeeds[4], pfSeed = streamSeeds[5];
+  if(mirrored) {//the particle filter's draws aren't Gaussian, it gets its own trial's stream instead
+    pfSeed = TrialStreamSeeds(_config.seed,unsigned(trial))[5];
+  }
+
+  /*Make the target*/
+  Target target(_config.trajectoryFile);//instantiate the target
+  CVKalmanFilter<>& kf2 = _kf;
+  IMM<>& immCT = _immCT;//kf1 and ekf1
+  IMM<>& immL = _immL;//kf1 and kf2
+  kf2.Reset(kf2Seed,mirrored);
+  immCT.Reset({kf1Seed,ekf1Seed},mirrored);
+  immL.Reset({kf1Seed,kf2Seed},mirrored);
+  MeasurementConverter converter(sensorState,sigmaR,sigmaTheta);
+  bool networked = !_config.network.empty();
+  SensorNetwork network(_config.network);
+  seed_seq networkSeeds{_config.seed,seedTrial,2u};
+  uint32_t networkSeed;
+  networkSeeds.generate(&networkSeed,&networkSeed+1);
+  network.Seed(networkSeed,mirrored);
+  vector<SensorMeasurement> scan, scan0;
+  seed_seq nodeSeeds{_config.seed,seedTrial,4u};
+  vector<uint32_t> nodeSeed(2*_nodes.size());
+  nodeSeeds.generate(nodeSeed.begin(),nodeSeed.end());
+  for(size_t k = 0;k<_nodes.size();k++) _nodes[k].Reset({nodeSeed[2*k],nodeSeed[2*k+1]},mirrored);
+  vector<vector<TrackFusion::Track>> nodeTracks(_nodes.size(),vector<TrackFusion::Track>(1));
+  vector<StateVector> controlTruth;//truth and sensor noise of every measurement, for the shadow filter
+  vector<MeasurementVector> controlNoise;
+  auto recordNoise = [&](const MeasurementVector& z) {
+    if(!_config.controlVariates) return;
+    StateVector truth = target.Sample();
+    controlTruth.push_back(truth);
+    controlNoise.push_back(z - converter.ToPolar(MeasurementVector(truth(0),truth(2))));
+  };
+  ConvertedMeasurement converted0, converted1;//the two initializing measurements, fused over the network if there is one
+  /*Get the initial  measurements*/
+  MeasurementVector z0, z1;
+  z0(0) = _range.Measure(target);
+  z0(1) = _azimuth.Measure(target);
+  recordNoise(z0);
+  if(networked) {
+    network.Measure(target,scan);
+    converted0 = network.Fuse(scan);
+    scan0 = scan;
+  }
+  target.Advance(_config.samplesPerStep);
+  z1(0) = _range.Measure(target);
+  z1(1) = _azimuth.Measure(target);
+  recordNoise(z1);
+  if(networked) {
+    network.Measure(target,scan);
+    converted1 = network.Fuse(scan);
+    for(size_t k = 0;k<_nodes.size();k++) {
+      const MeasurementConverter& nodeConverter = network.GetConverter(k);
+      _nodes[k].Initialize(nodeConverter.Convert(scan0[k].z),nodeConverter.Convert(scan[k].z));
+    }
+  }
+  target.Advance(_config.samplesPerStep);
+
+  ofstream immCTData(path+"immCT.txt");
+  ofstream immLData(path+"immL.txt");
+  ofstream kfData(path + "kf.txt");
+  ofstream measurements(path+"measurements.txt");
+  if(!networked) {
+    converted0 = converter.Convert(z0);
+    converted1 = converter.Convert(z1);
+  }
+  kf2.Initialize(converted0,converted1);
+  immCT.Initialize(converted0,converted1);
+  immL.Initialize(converted0,converted1);
+  ParticleFilter pf(sensorState, sigmaR, sigmaTheta, Ts, _config.pfSigmaAccelerationCV, _config.pfSigmaAccelerationCT,
+                    _config.pfSigmaOmega, _config.runParticleFilter ? _config.numParticles : 1, _config.numThreads,
+                    pfSeed);
+  if(_config.runParticleFilter) pf.Initialize(z0,z1);
+  ClutterSensor clutter(_range,_azimuth,_config.Pd,_config.falseAlarmRate,
+                        _config.clutterRMin,_config.clutterRMax,_config.clutterThetaMin,_config.clutterThetaMax);
+  seed_seq clutterSeeds{_config.seed,seedTrial,1u};//a separate sequence leaves the other streams untouched
+  uint32_t clutterSeed;
+  clutterSeeds.generate(&clutterSeed,&clutterSeed+1);
+  clutter.Seed(clutterSeed);
+  PDAParameters pda;
+  pda.Pd = _config.Pd;
+  pda.Pg = _config.Pg;
+  pda.clutterDensity = clutter.GetClutterDensity();
+  vector<MeasurementVector> returns;
+  ConvertedScan clutterScan;
+  seed_seq missSeeds{_config.seed,seedTrial,3u};
+  uint32_t missSeed;
+  missSeeds.generate(&missSeed,&missSeed+1);
+  mt19937 missGenerator(missSeed);
+  bernoulli_distribution missed(_config.missProbability);
+  if(_config.pipelined) {
+    const int steps = NUM_SAMPLES-1;
+    int numStages = _config.runParticleFilter ? 4 : 3;
+    SampleQueue samples[4];
+    OutputQueue outputs[4];
+    vector<thread> stages;
+    stages.emplace_back([&]() {//truth and sensors
+      SensorSample sample;
+      for(int i = 0;i<steps;i++) {
+        MeasurementVector z;
+        sample.truth = target.Sample();
+        z(0) = _range.Measure(target);
+        z(1) = _azimuth.Measure(target);
+        recordNoise(z);
+        measurements<<z(0)*cos(z(1))-10000<<","<<z(0)*sin(z(1))<<endl;
+        sample.z = converter.Convert(z);
+        for(int s = 0;s<numStages;s++) samples[s].Push(sample);
+        target.Advance(_config.samplesPerStep);
+      }
+    });
+    stages.emplace_back([&]() { FilterStage(immCT,samples[0],outputs[0],steps); });
+    stages.emplace_back([&]() { FilterStage(immL,samples[1],outputs[1],steps); });
+    stages.emplace_back([&]() { FilterStage(kf2,samples[2],outputs[2],steps); });
+    if(_config.runParticleFilter) stages.emplace_back([&]() { FilterStage(pf,samples[3],outputs[3],steps); });
+    /*evaluation runs here*/
+    PerformanceEvaluator* evaluators[4] = {&_peIMMCT,&_peIMML,&_peKF,&_pePF};
+    ofstream* logs[4] = {&immCTData,&immLData,&kfData,nullptr};
+    IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");
+    FilterOutput output;
+    for(int i = 0;i<steps;i++) {
+      for(int s = 0;s<numStages;s++) {
+        outputs[s].Pop(output);
+        if(logs[s]) *logs[s]<<output.x.format(myFormat)<<endl;
+        evaluators[s]->EvaluateIntermediate(make_pair(output.x,output.P),output.MOD2PR,output.zReal,output.truth);
+      }
+    }
+    for(auto& stage:stages) stage.join();
+  }
+  else for (int i = 0; i < NUM_SAMPLES-1;i++) {
+    x = target.Sample();
+    if(_config.clutter) {//every return of the scan goes to every filter, each gates and associates on its own
+      clutter.Scan(target,returns);
+      converter.ConvertScan(returns,clutterScan);
+      immCT.UpdatePDA(clutterScan,pda);
+      immL.UpdatePDA(clutterScan,pda);
+      kf2.UpdatePDA(clutterScan,pda);
+    }
+    else if(networked) {//centralized: the whole network's scan is one measurement to the bank
+      network.Measure(target,scan);
+      ConvertedMeasurement converted = network.Fuse(scan);
+      measurements<<converted.z(0)<<","<<converted.z(1)<<endl;
+      immCT.Update(converted);
+      immL.Update(converted);
+      kf2.Update(converted);
+      if(_config.distributed) {//each radar tracks on its own, only the tracks meet
+        double modeProbability = 0;
+        for(size_t k = 0;k<_nodes.size();k++) {
+          nodeTracks[k][0] = _nodes[k].Update(network.GetConverter(k).Convert(scan[k].z));
+          modeProbability += _nodes[k].GetMOD2PR()/_nodes.size();
+        }
+        vector<TrackFusion::Track> system = _fusion.Fuse(nodeTracks);//the first is the one radar 0's track joined
+        _peT2T.EvaluateIntermediate(system[0],modeProbability,converted.z,target.Sample());
+      }
+    }
+    else {
+      z1(0) = _range.Measure(target);//drawn even when missed, so the other scans see the same noise
+      z1(1) = _azimuth.Measure(target);
+      recordNoise(z1);
+      if(_config.missProbability > 0 && missed(missGenerator)) {
+        immCT.Coast(1);
+        immL.Coast(1);
+        kf2.Coast(1);
+      }
+      else {
+        measurements<<z1(0)*cos(z1(1))-10000<<","<<z1(0)*sin(z1(1))<<endl;
+        ConvertedMeasurement converted = converter.Convert(z1);//once for the whole bank
+        immCT.Update(converted);
+        immL.Update(converted);
+        kf2.Update(converted);
+        if(_config.runParticleFilter) pf.Update(converted);
+      }
+    }
+    immCTData<<immCT;
+    immLData<<immL;
+    kfData<<kf2;
+    _peIMMCT.EvaluateIntermediate(immCT.GetEstimate(),immCT.GetMOD2PR(),immCT.GetRealZ(),target.Sample());
+    _peIMML.EvaluateIntermediate(immL.GetEstimate(),immL.GetMOD2PR(),immL.GetRealZ(),target.Sample());
+    _peKF.EvaluateIntermediate(kf2.GetEstimate(),0,kf2.GetRealZ(),target.Sample());
+    if(_config.runParticleFilter) {
+      _pePF.EvaluateIntermediate(pf.GetEstimate(),pf.GetMOD2PR(),pf.GetRealZ(),target.Sample());
+    }
+    target.Advance(_config.samplesPerStep);
+  }
+  map<string,double> controls;
+  if(_config.controlVariates) controls = _shadow.Controls(controlTruth,controlNoise);
+  for(auto pe:_PEs) pe->FinishEvaluatingRun(controls);
+  immCTData.close();
+  immLData.close();
+  kfData.close();
+}
+
+void MonteCarloStudy::Finish() {
+  ResultsStore store;
+  store.AddConfiguration(_config,GetCompletedTrials());
+  if(_config.Adaptive()) {
+    string reason = TargetsMet() ? "targets met" : "trial budget";
+    store.AddMetadata("stopReason",reason);
+    cout<<"stopped after "<<GetCompletedTrials()<<" trials: "<<reason<<endl;
+  }
+  for(size_t i = 0;i<_PEs.size();i++) {
+    PerformanceEvaluator& pe = *_PEs[i];
+    const RunningStatistics& squares = pe.GetTrialStatistics("RMSPOS");
+    const RunningStatistics& nees = pe.GetTrialStatistics("NEES");
+    pair<double,double> rms = RMSInterval(make_pair(squares.Mean(),squares.HalfWidth(_config.confidence)));
+    store.AddMetadata(_peNames[i]+"/RMSPOS",ToString(rms.first));
+    store.AddMetadata(_peNames[i]+"/RMSPOS_halfWidth",ToString(rms.second));
+    store.AddMetadata(_peNames[i]+"/ANEES",ToString(nees.Mean()));
+    store.AddMetadata(_peNames[i]+"/ANEES_halfWidth",ToString(nees.HalfWidth(_config.confidence)));
+    if(_config.controlVariates) {
+      pair<double,double> rmsControlled = RMSInterval(TrialInterval(pe,"RMSPOS"));
+      pair<double,double> neesControlled = TrialInterval(pe,"NEES");
+      store.AddMetadata(_peNames[i]+"/RMSPOS_cv",ToString(rmsControlled.first));
+      store.AddMetadata(_peNames[i]+"/RMSPOS_cv_halfWidth",ToString(rmsControlled.second));
+      store.AddMetadata(_peNames[i]+"/RMSPOS_cv_correlation",ToString(pe.GetControlledStatistics("RMSPOS").Correlation()));
+      store.AddMetadata(_peNames[i]+"/ANEES_cv",ToString(neesControlled.first));
+      store.AddMetadata(_peNames[i]+"/ANEES_cv_halfWidth",ToString(neesControlled.second));
+      store.AddMetadata(_peNames[i]+"/ANEES_cv_correlation",ToString(pe.GetControlledStatistics("NEES").Correlation()));
+    }
+    if(_config.Adaptive() || _config.antithetic || _config.controlVariates) {
+      pair<double,double> rmsReported = RMSInterval(TrialInterval(pe,"RMSPOS")), neesReported = TrialInterval(pe,"NEES");
+      cout<<_peNames[i]<<": RMSPOS "<<rmsReported.first<<" +- "<<rmsReported.second<<" m, ANEES "
+          <<neesReported.first<<" +- "<<neesReported.second<<endl;
+    }
+    _PEs[i]->CalculateFinalResults();
+    _PEs[i]->WriteResultsToFile();
+    store.AddEvaluator(_peNames[i],*_PEs[i]);
+  }
+  store.Write(_config.path+"Performance Data/results.etpr");
+}
+
+/*Written to a temporary file and renamed over the old checkpoint, so a crash mid-write keeps the previous one*/
+void MonteCarloStudy::SaveCheckpoint(string filename) {
+  string temporary = filename + ".tmp";
+  {
+    ofstream of(temporary,ios::binary);
+    of.write(checkpointMagic.data(),checkpointMagic.size());
+    WriteBinary<uint32_t>(of,checkpointVersion);
+    WriteBinary<uint32_t>(of,_config.seed);
+    WriteBinary<uint64_t>(of,StudyHash(_config));
+    WriteString(of,_config.trajectoryFile);
+    WriteString(of,StudySettings(_config));
+    WriteBinary<int32_t>(of,_firstTrial);
+    WriteBinary<int32_t>(of,_trial);
+    WriteBinary<uint32_t>(of,_PEs.size());
+    for(auto pe:_PEs) pe->SaveState(of);
+    if(!of) throw runtime_error("could not write checkpoint " + temporary);
+  }
+  if(rename(temporary.c_str(),filename.c_str()) != 0) throw runtime_error("could not replace checkpoint " + filename);
+}
+
+void MonteCarloStudy::LoadCheckpoint(string filename) {
+  ifstream in(filename,ios::binary);
+  if(!in) throw runtime_error("could not open checkpoint " + filename);
+  CheckpointHeader header = ReadCheckpointHeader(in,filename);
+  _config.seed = header.seed;
+  if(header.settings != StudySettings(_config) || header.study != StudyHash(_config)) {
+    throw runtime_error(filename + " was run with another configuration or trajectory");
+  }
+  if(_config.firstTrial != header.firstTrial) {//resuming a shard keeps its range
+    _config.numTrials += _config.firstTrial - header.firstTrial;
+    _config.firstTrial = header.firstTrial;
+  }
+  _firstTrial = header.firstTrial;
+  _trial = header.trial;
+  if(ReadBinary<uint32_t>(in) != _PEs.size()) throw runtime_error("checkpoint was written with a different filter set");
+  for(auto pe:_PEs) pe->LoadState(in);
+}
+
+/*Every shard must have been run with the study's settings. The first merged checkpoint fixes the seed and the study
+ * hash, the rest must share them and cover trial ranges disjoint from everything merged so far. Summation order
+ * differs from a single process, so sums agree to rounding rather than bitwise.*/
+void MonteCarloStudy::MergeCheckpoint(string filename) {
+  ifstream in(filename,ios::binary);
+  if(!in) throw runtime_error("could not open checkpoint " + filename);
+  CheckpointHeader header = ReadCheckpointHeader(in,filename);
+  if(header.settings != StudySettings(_config)) throw runtime_error(filename + " was run with other settings");
+  if(_mergedRanges.empty()) {
+    _config.seed = header.seed;
+    _mergedStudy = header.study;
+  }
+  else if(header.seed != _config.seed) throw runtime_error(filename + " was run with a different seed");
+  else if(header.study != _mergedStudy) throw runtime_error(filename + " was run on another trajectory or version");
+  for(auto& range:_mergedRanges) {
+    if(header.firstTrial < range.second && range.first < header.trial) {
+      throw runtime_error(filename + " overlaps trials already merged");
+    }
+  }
+  _mergedRanges.push_back(make_pair(header.firstTrial,header.trial));
+  if(ReadBinary<uint32_t>(in) != _PEs.size()) throw runtime_error(filename + " was written with a different filter set");
+  for(auto pe:_PEs) {
+    PerformanceEvaluator shard;
+    shard.LoadState(in);
+    pe->Merge(shard);
+  }
+  _trial += header.trial - header.firstTrial;
+}
+
+int MonteCarloStudy::GetCompletedTrials() {
+  return _trial - _firstTrial;
+}
+
+void MonteCarloStudy::CheckpointConfiguration(string filename, StudyConfiguration& config) {
+  ifstream in(filename,ios::binary);
+  if(!in) throw runtime_error("could not open checkpoint " + filename);
+  CheckpointHeader header = ReadCheckpointHeader(in,filename);
+  config.seed = header.seed;
+  config.trajectoryFile = header.trajectoryFile;
+  istringstream settings(header.settings);
+  ReadStudySettings(settings,config);
+}
+
+uint32_t MonteCarloStudy::CheckpointVersion() {
+  return checkpointVersion;
+}
+
+int MonteCarloStudy::CheckpointCompletedTrials(string filename) {
+  ifstream in(filename,ios::binary);
+  if(!in) throw runtime_error("could not open checkpoint " + filename);
+  CheckpointHeader header = ReadCheckpointHeader(in,filename);
+  return header.trial - header.firstTrial;
+}
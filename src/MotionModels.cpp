@@ -0,0 +1,331 @@
+//
+// Created by clancy on 5/2/16.
+//
+
+#include "../include/MotionModels.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+/*Everything a model block is built from*/
+template<class VMatrix>
+vector<double> ModelKey(StateVector sensorState, TimeType Ts, const VMatrix& V, double sigmaR, double sigmaTheta) {
+  vector<double> key(sensorState.data(),sensorState.data()+sensorState.size());
+  key.push_back(Ts);
+  key.insert(key.end(),V.data(),V.data()+V.size());
+  key.push_back(sigmaR);
+  key.push_back(sigmaTheta);
+  return key;
+}
+
+/*FNV-1a over the state dimension and the key*/
+uint64_t Fingerprint(int states, const vector<double>& key) {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&](const void* data, size_t size) {
+    for(size_t i = 0;i<size;i++) {
+      hash ^= static_cast<const unsigned char*>(data)[i];
+      hash *= 1099511628211ull;
+    }
+  };
+  add(&states,sizeof(states));
+  add(key.data(),key.size()*sizeof(double));
+  return hash;
+}
+
+/*One cache per model type. It only holds weak references, a block lives as long as some filter points at it. The
+ * expired entries are swept on every lookup, so a sweep over sites or noise levels doesn't leave its keys behind.*/
+template<class Model>
+shared_ptr<const Model> CachedModel(const vector<double>& key, const function<shared_ptr<Model>()>& build) {
+  static mutex cacheMutex;
+  static map<vector<double>,weak_ptr<const Model>> cache;
+  lock_guard<mutex> lock(cacheMutex);
+  for(auto entry = cache.begin();entry != cache.end();) {
+    if(entry->second.expired()) entry = cache.erase(entry);
+    else ++entry;
+  }
+  shared_ptr<const Model> model = cache[key].lock();
+  if(!model) {
+    shared_ptr<Model> built = build();
+    built->fingerprint = Fingerprint(built->H.cols(),key);
+    model = built;
+    cache[key] = model;
+  }
+  return model;
+}
+
+template<class PrecisionPolicy>
+shared_ptr<typename CVKalmanFilter<PrecisionPolicy>::Model> BuildCVModel(StateVector sensorState,
+                                                                         TimeType Ts,
+                                                                         CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                                         double sigmaR,
+                                                                         double sigmaTheta) {
+  typedef CVKalmanFilter<PrecisionPolicy> Filter;
+  typedef typename Filter::StateScalar StateScalar;
+  typedef typename Filter::CovarianceScalar CovarianceScalar;
+  CVKalmanFilter<>::ModelSystemMatrix F;
+  CVKalmanFilter<>::ModelNoiseGainMatrix Gamma;
+  CVKalmanFilter<>::ModelMeasurementMatrix H;
+  CVKalmanFilter<>::ModelProcessNoiseCovarianceMatrix Q;
+  MeasurementCovarianceMatrix R;
+
+  Gamma <<
+  0.5*Ts*Ts, 0,
+  Ts,        0,
+  0,         0.5*Ts*Ts,
+  0,         Ts;
+
+  F << 1, Ts, 0, 0,
+       0, 1, 0, 0,
+       0, 0, 1, Ts,
+       0, 0, 0, 1;
+
+  typename Filter::ModelSystemMatrix FCov = F.template cast<CovarianceScalar>();
+  typename Filter::ModelPropagationMatrix FState = F.template cast<StateScalar>();
+  typename Filter::ModelNoiseGainMatrix GammaState = Gamma.template cast<StateScalar>();
+  function<typename Filter::ModelSystemMatrix(typename Filter::ModelStateVector)> generateSystemMatrix =
+          [FCov] (typename Filter::ModelStateVector) {
+    return FCov;
+  };
+  function<typename Filter::ModelStateVector(typename Filter::ModelStateVector,typename Filter::ModelProcessNoiseVector)> predictState =
+          [FState,GammaState] (typename Filter::ModelStateVector x, typename Filter::ModelProcessNoiseVector sigmaV) -> typename Filter::ModelStateVector {
+    return FState*x + GammaState*sigmaV;
+  };
+  Q = Gamma*(V*V)*Gamma.transpose();//multiply V twice to get the variances
+  H << 1, 0, 0, 0,
+       0, 0, 1, 0;
+  R<<sigmaR*sigmaR, 0,
+     0,    sigmaTheta*sigmaTheta;
+
+  auto model = make_shared<typename Filter::Model>();
+  model->converter = MeasurementConverter(sensorState,sigmaR,sigmaTheta);
+  model->Ts = Ts;
+  model->H = H.template cast<CovarianceScalar>();
+  model->Q = Q.template cast<CovarianceScalar>();
+  model->initialR = R.template cast<CovarianceScalar>();
+  model->predictState = predictState;
+  model->generateSystemMatrix = generateSystemMatrix;
+  model->processNoiseStdDev = V.diagonal();
+  model->structure = CovarianceStructure::AxisBlocks;
+  model->linear = true;
+  model->F = F;
+  return model;
+}
+
+template<class PrecisionPolicy>
+shared_ptr<typename CTExtendedKalmanFilter<PrecisionPolicy>::Model> BuildCTModel(StateVector sensorState,
+                                                                                 TimeType Ts,
+                                                                                 CTExtendedKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                                                 double sigmaR,
+                                                                                 double sigmaTheta) {
+  typedef CTExtendedKalmanFilter<PrecisionPolicy> Filter;
+  typedef typename Filter::StateScalar StateScalar;
+  typedef typename Filter::CovarianceScalar CovarianceScalar;
+  typedef typename Filter::ModelStateVector CTStateVector;
+  typedef typename Filter::ModelSystemMatrix CTSystemMatrix;
+  CTSystemMatrix F;
+  typename Filter::ModelPropagationMatrix FState;
+  CTExtendedKalmanFilter<>::ModelNoiseGainMatrix Gamma;
+  CTExtendedKalmanFilter<>::ModelMeasurementMatrix H;
+  CTExtendedKalmanFilter<>::ModelProcessNoiseCovarianceMatrix Q;
+  MeasurementCovarianceMatrix R;
+
+  Gamma <<
+          0.5*Ts*Ts, 0,         0,
+          Ts,        0,         0,
+          0,         0.5*Ts*Ts, 0,
+          0,         Ts,        0,
+          0,         0,         Ts;
+
+
+  F <<1, Ts, 0, 0, 0,
+      0, 1, 0, 0, 0,
+      0, 0, 1, Ts, 0,
+      0, 0, 0, 1, 0,
+      0, 0, 0, 0, 1;
+  FState = F.template cast<StateScalar>();
+  typename Filter::ModelNoiseGainMatrix GammaState = Gamma.template cast<StateScalar>();
+  /* Calculate Jacobians - CHECKED GOOD*/
+  function<StateVector(CTStateVector)> calculateJacobians = [Ts] (CTStateVector x) {
+    StateVector j;
+    double Om = x(4), xDot = x(1), yDot = x(3);// omega, x derivative, y derivative
+    double c = cos(Om*Ts), s = sin(Om*Ts);
+    j(0) = (c*Ts*xDot/Om) - (s*xDot/(Om*Om)) - (s*Ts*yDot/Om) - ((-1+c)*yDot/(Om*Om));
+    j(1) = -s*Ts*xDot - c*Ts*yDot;
+    j(2) = (s*Ts*xDot/Om) - ((1-c)*xDot/(Om*Om)) + (c*Ts*yDot/Om) - (s*yDot/(Om*Om));
+    j(3) = c*Ts*xDot - s*Ts*yDot;
+    j(4) = 1;
+    return j;
+  };
+/*generateSystemMatrix - CHECKED GOOD*/
+  function<CTSystemMatrix(CTStateVector)> generateSystemMatrix = [=] (CTStateVector x) {
+    CTSystemMatrix F;//a local, the block is shared between threads
+    double Om = x(4);//Omega
+    if(abs(Om)>.0001) {
+      double s = sin (Om*Ts), c = cos(Om*Ts);//omega, and the trig terms
+      StateVector j = calculateJacobians(x);
+      F <<1, s/Om,        0, -(1-c)/Om, j(0),
+          0, c,           0, -s,        j(1),
+          0, (1-c)/Om,    1, s/Om,      j(2),
+          0, s,           0, c,         j(3),
+          0, 0,           0, 0,         1;
+    }
+    else {
+      double xDot = x(1), yDot = x(3);
+      F << 1, Ts, 0, 0,  -0.5*Ts*Ts*yDot,
+           0, 1,  0, 0,  -Ts*yDot,
+           0, 0,  1, Ts, 0.5*Ts*Ts*xDot,
+           0, 0,  0, 1,  Ts*xDot,
+           0, 0,  0, 0,  1;
+    }
+    return F;
+  };
+  /*predictState - CHECKED GOOD*/
+  function<CTStateVector(CTStateVector,typename Filter::ModelProcessNoiseVector)> predictState =
+          [=] (CTStateVector x, typename Filter::ModelProcessNoiseVector sigmaV) -> CTStateVector {
+    double Om = x(4);
+    typename Filter::ModelPropagationMatrix FOm = FState;//the omega -> 0 limit, so a reset filter predicts as a new one
+    if(abs(Om)>.0001) {//don't use the limiting form!
+      double s = sin (Om*Ts), c = cos(Om*Ts);//omega, and the trig terms
+      FOm <<1, s/Om,     0, -(1-c)/Om, 0,
+            0, c,        0, -s,        0,
+            0, (1-c)/Om, 1, s/Om,      0,
+            0, s,        0, c,         0,
+            0, 0,        0, 0,         1;
+    }
+    return FOm*x + GammaState*sigmaV;
+  };
+  Q = Gamma*(V*V)*Gamma.transpose();//multiply V twice to get the variances
+  H << 1, 0, 0, 0, 0,
+       0, 0, 1, 0, 0;
+  R<<sigmaR*sigmaR, 0,
+     0,    sigmaTheta*sigmaTheta;//.0003046 is 1 degree squared in radians
+
+  auto model = make_shared<typename Filter::Model>();
+  model->converter = MeasurementConverter(sensorState,sigmaR,sigmaTheta);
+  model->Ts = Ts;
+  model->H = H.template cast<CovarianceScalar>();
+  model->Q = Q.template cast<CovarianceScalar>();
+  model->initialR = R.template cast<CovarianceScalar>();
+  model->predictState = predictState;
+  model->generateSystemMatrix = generateSystemMatrix;
+  model->processNoiseStdDev = V.diagonal();
+  model->structure = CovarianceStructure::TurnRateColumn;
+  return model;
+}
+
+template<class PrecisionPolicy>
+shared_ptr<typename CAKalmanFilter<PrecisionPolicy>::Model> BuildCAModel(StateVector sensorState,
+                                                                         TimeType Ts,
+                                                                         CAKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                                         double sigmaR,
+                                                                         double sigmaTheta) {
+  typedef CAKalmanFilter<PrecisionPolicy> Filter;
+  typedef typename Filter::StateScalar StateScalar;
+  typedef typename Filter::CovarianceScalar CovarianceScalar;
+  CAKalmanFilter<>::ModelSystemMatrix F;
+  CAKalmanFilter<>::ModelNoiseGainMatrix Gamma;
+  CAKalmanFilter<>::ModelMeasurementMatrix H;
+  CAKalmanFilter<>::ModelProcessNoiseCovarianceMatrix Q;
+  MeasurementCovarianceMatrix R;
+
+  Gamma <<
+  0.5*Ts*Ts, 0,
+  Ts,        0,
+  0,         0.5*Ts*Ts,
+  0,         Ts,
+  1,         0,
+  0,         1;
+
+  F << 1, Ts, 0, 0,  0.5*Ts*Ts, 0,
+       0, 1,  0, 0,  Ts,        0,
+       0, 0,  1, Ts, 0,         0.5*Ts*Ts,
+       0, 0,  0, 1,  0,         Ts,
+       0, 0,  0, 0,  1,         0,
+       0, 0,  0, 0,  0,         1;
+
+  typename Filter::ModelSystemMatrix FCov = F.template cast<CovarianceScalar>();
+  typename Filter::ModelPropagationMatrix FState = F.template cast<StateScalar>();
+  typename Filter::ModelNoiseGainMatrix GammaState = Gamma.template cast<StateScalar>();
+  function<typename Filter::ModelSystemMatrix(typename Filter::ModelStateVector)> generateSystemMatrix =
+          [FCov] (typename Filter::ModelStateVector) {
+    return FCov;
+  };
+  function<typename Filter::ModelStateVector(typename Filter::ModelStateVector,typename Filter::ModelProcessNoiseVector)> predictState =
+          [FState,GammaState] (typename Filter::ModelStateVector x, typename Filter::ModelProcessNoiseVector sigmaV) -> typename Filter::ModelStateVector {
+    return FState*x + GammaState*sigmaV;
+  };
+  Q = Gamma*(V*V)*Gamma.transpose();//multiply V twice to get the variances
+  H << 1, 0, 0, 0, 0, 0,
+       0, 0, 1, 0, 0, 0;
+  R<<sigmaR*sigmaR, 0,
+     0,    sigmaTheta*sigmaTheta;
+
+  auto model = make_shared<typename Filter::Model>();
+  model->converter = MeasurementConverter(sensorState,sigmaR,sigmaTheta);
+  model->Ts = Ts;
+  model->H = H.template cast<CovarianceScalar>();
+  model->Q = Q.template cast<CovarianceScalar>();
+  model->initialR = R.template cast<CovarianceScalar>();
+  model->predictState = predictState;
+  model->generateSystemMatrix = generateSystemMatrix;
+  model->processNoiseStdDev = V.diagonal();
+  model->structure = CovarianceStructure::Dense;
+  model->linear = true;
+  model->F = F;
+  return model;
+}
+}
+
+template<class PrecisionPolicy>
+CVKalmanFilter<PrecisionPolicy> setupCVKalmanFilter(StateVector sensorState,
+                                                    TimeType Ts,
+                                                    CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                    double sigmaR,
+                                                    double sigmaTheta,
+                                                    unsigned seed) {
+  typedef typename CVKalmanFilter<PrecisionPolicy>::Model Model;
+  return CVKalmanFilter<PrecisionPolicy>(CachedModel<Model>(ModelKey(sensorState,Ts,V,sigmaR,sigmaTheta), [&] {
+    return BuildCVModel<PrecisionPolicy>(sensorState,Ts,V,sigmaR,sigmaTheta);
+  }), seed);
+}
+
+template<class PrecisionPolicy>
+CTExtendedKalmanFilter<PrecisionPolicy> setupCTExtendedKalmanFilter(StateVector sensorState,
+                                                                    TimeType Ts,
+                                                                    CTExtendedKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                                    double sigmaR,
+                                                                    double sigmaTheta,
+                                                                    unsigned seed) {
+  typedef typename CTExtendedKalmanFilter<PrecisionPolicy>::Model Model;
+  return CTExtendedKalmanFilter<PrecisionPolicy>(CachedModel<Model>(ModelKey(sensorState,Ts,V,sigmaR,sigmaTheta), [&] {
+    return BuildCTModel<PrecisionPolicy>(sensorState,Ts,V,sigmaR,sigmaTheta);
+  }), seed);
+}
+
+template<class PrecisionPolicy>
+CAKalmanFilter<PrecisionPolicy> setupCAKalmanFilter(StateVector sensorState,
+                                                    TimeType Ts,
+                                                    CAKalmanFilter<>::ModelVProcessNoiseGainMatrix V,
+                                                    double sigmaR,
+                                                    double sigmaTheta,
+                                                    unsigned seed) {
+  typedef typename CAKalmanFilter<PrecisionPolicy>::Model Model;
+  return CAKalmanFilter<PrecisionPolicy>(CachedModel<Model>(ModelKey(sensorState,Ts,V,sigmaR,sigmaTheta), [&] {
+    return BuildCAModel<PrecisionPolicy>(sensorState,Ts,V,sigmaR,sigmaTheta);
+  }), seed);
+}
+
+#define INSTANTIATE_MOTION_MODELS(PrecisionPolicy) \
+  template CVKalmanFilter<PrecisionPolicy> setupCVKalmanFilter<PrecisionPolicy>( \
+          StateVector, TimeType, CVKalmanFilter<>::ModelVProcessNoiseGainMatrix, double, double, unsigned); \
+  template CTExtendedKalmanFilter<PrecisionPolicy> setupCTExtendedKalmanFilter<PrecisionPolicy>( \
+          StateVector, TimeType, CTExtendedKalmanFilter<>::ModelVProcessNoiseGainMatrix, double, double, unsigned); \
+  template CAKalmanFilter<PrecisionPolicy> setupCAKalmanFilter<PrecisionPolicy>( \
+          StateVector, TimeType, CAKalmanFilter<>::ModelVProcessNoiseGainMatrix, double, double, unsigned);
+
+INSTANTIATE_MOTION_MODELS(DoublePrecision)
+INSTANTIATE_MOTION_MODELS(SinglePrecision)
+INSTANTIATE_MOTION_MODELS(MixedPrecision)
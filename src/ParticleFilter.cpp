@@ -0,0 +1,333 @@
+//
+// Created by clancy on 5/5/16.
+//
+
+#include "../include/ParticleFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const int particleChunks = 64;//fixed, so the results don't depend on the machine
+}
+
+ParticleFilter::ParticleFilter(StateVector sensorState,
+                               double sigmaR,
+                               double sigmaTheta,
+                               TimeType Ts,
+                               double sigmaAccelerationCV,
+                               double sigmaAccelerationCT,
+                               double sigmaOmega,
+                               int numParticles,
+                               int numThreads,
+                               unsigned seed):
+                                 _sensorState(sensorState),
+                                 _sigmaR(sigmaR),
+                                 _sigmaTheta(sigmaTheta),
+                                 _Ts(Ts),
+                                 _sigmaAccelerationCV(sigmaAccelerationCV),
+                                 _sigmaAccelerationCT(sigmaAccelerationCT),
+                                 _sigmaOmega(sigmaOmega),
+                                 _sigmaOmegaInitial(3.14159265358979*2/180),//the term project turns at up to 2 deg/s
+                                 _resampleThreshold(.5),
+                                 _numParticles(numParticles),
+                                 _numChunks(max(1,min(particleChunks,numParticles))),
+                                 _numThreads(max(1,min(numThreads,_numChunks))){
+  _p<<.95,.05,
+      .05,.95;
+  for(Column* c:{&_x,&_xDot,&_y,&_yDot,&_omega,&_logWeight,&_weight,&_xNext,&_xDotNext,&_yNext,&_yDotNext,&_omegaNext,
+                 &_cumulativeWeight,&_noise1,&_noise2,&_noise3,&_uniform}) {
+    c->resize(_numParticles);
+  }
+  _mode.resize(_numParticles);
+  _modeNext.resize(_numParticles);
+  _ancestor.resize(_numParticles);
+
+  mt19937 seeder(seed);
+  for(int c = 0;c<=_numChunks;c++) _chunkBegin.push_back(int((long long)_numParticles*c/_numChunks));
+  for(int c = 0;c<_numChunks;c++) _generators.push_back(mt19937(seeder()));
+  for(int w = 1;w<_numThreads;w++) _workers.push_back(thread(&ParticleFilter::Work,this,w));
+}
+
+ParticleFilter::~ParticleFilter() {
+  {
+    lock_guard<mutex> lock(_phaseMutex);
+    _stopping = true;
+  }
+  _phaseStart.notify_all();
+  for(auto& w:_workers) w.join();
+}
+
+void ParticleFilter::RunChunks(const function<void(int,int,int)>& f, int worker) {
+  for(int c = worker;c<_numChunks;c += _numThreads) f(c,_chunkBegin[c],_chunkBegin[c+1]);
+}
+
+void ParticleFilter::Work(int worker) {
+  unsigned done = 0;
+  while(true) {
+    const function<void(int,int,int)>* f;
+    {
+      unique_lock<mutex> lock(_phaseMutex);
+      _phaseStart.wait(lock,[&]() { return _stopping || _phaseNumber != done; });
+      if(_stopping) return;
+      done = _phaseNumber;
+      f = _phase;
+    }
+    RunChunks(*f,worker);
+    lock_guard<mutex> lock(_phaseMutex);
+    if(--_busyWorkers == 0) _phaseDone.notify_one();
+  }
+}
+
+/*Runs f once per chunk on the pool and returns when every chunk is done*/
+void ParticleFilter::ParallelFor(function<void(int chunk,int begin,int end)> f) {
+  if(_workers.empty()) {
+    RunChunks(f,0);
+    return;
+  }
+  {
+    lock_guard<mutex> lock(_phaseMutex);
+    _phase = &f;
+    _busyWorkers = int(_workers.size());
+    _phaseNumber++;
+  }
+  _phaseStart.notify_all();
+  RunChunks(f,0);
+  unique_lock<mutex> lock(_phaseMutex);
+  _phaseDone.wait(lock,[&]() { return _busyWorkers == 0; });
+}
+
+void ParticleFilter::Initialize(MeasurementVector z0, MeasurementVector z1) {
+  ParallelFor([&](int chunk,int begin,int end) {
+    mt19937& generator = _generators[chunk];
+    normal_distribution<double> normal(0,1);
+    uniform_real_distribution<double> uniform(0,1);
+    for(int i = begin;i<end;i++) {
+      /*draw both measurements from the sensor noise so the cloud matches the two-point differencing uncertainty*/
+      double r0 = z0(0) + _sigmaR*normal(generator), theta0 = z0(1) + _sigmaTheta*normal(generator);
+      double r1 = z1(0) + _sigmaR*normal(generator), theta1 = z1(1) + _sigmaTheta*normal(generator);
+      double x0 = r0*cos(theta0) + _sensorState(0), y0 = r0*sin(theta0) + _sensorState(2);
+      double x1 = r1*cos(theta1) + _sensorState(0), y1 = r1*sin(theta1) + _sensorState(2);
+      _x(i) = x1;
+      _xDot(i) = (x1-x0)/_Ts;
+      _y(i) = y1;
+      _yDot(i) = (y1-y0)/_Ts;
+      _mode(i) = uniform(generator) < .5 ? 0 : 1;
+      _omega(i) = _mode(i) == 1 ? _sigmaOmegaInitial*normal(generator) : 0;
+    }
+    _logWeight.segment(begin,end-begin).setConstant(-log(double(_numParticles)));
+    _weight.segment(begin,end-begin).setConstant(1.0/_numParticles);
+  });
+  Estimate();
+}
+
+pair<StateVector,StateCovarianceMatrix> ParticleFilter::Update(MeasurementVector measurement) {
+  _zReal(0) = measurement(0)*cos(measurement(1)) + _sensorState(0);
+  _zReal(1) = measurement(0)*sin(measurement(1)) + _sensorState(2);
+  Propagate();
+  Weigh(measurement);
+  Normalize();
+  Estimate();//estimate before resampling, it only adds noise
+  if(_effectiveSampleSize < _resampleThreshold*_numParticles) Resample();
+  _t++;
+  return make_pair(_xEstimate,_PEstimate);
+}
+
+void ParticleFilter::Propagate() {
+  ParallelFor([this](int chunk,int begin,int end) {
+    int n = end-begin;
+    mt19937& generator = _generators[chunk];
+    normal_distribution<double> normal(0,1);
+    uniform_real_distribution<double> uniform(0,1);
+    for(int i = begin;i<end;i++) {
+      _noise1(i) = normal(generator);
+      _noise2(i) = normal(generator);
+      _noise3(i) = normal(generator);
+      _uniform(i) = uniform(generator);
+    }
+    /*mode switches, a particle entering CT draws a fresh turn rate*/
+    for(int i = begin;i<end;i++) {
+      int m = _mode(i);
+      if(_uniform(i) < _p(m,1-m)) {
+        _mode(i) = 1-m;
+        _omega(i) = m == 0 ? _sigmaOmegaInitial*_noise3(i) : 0;
+      }
+      else if(m == 1) {
+        _omega(i) += _sigmaOmega*_noise3(i);
+      }
+    }
+
+    /*exact coordinated turn, the limiting form for |omega| -> 0 is the CV transition*/
+    auto x = _x.segment(begin,n), xDot = _xDot.segment(begin,n), y = _y.segment(begin,n), yDot = _yDot.segment(begin,n);
+    auto omega = _omega.segment(begin,n);
+    auto s = _xNext.segment(begin,n), c = _yNext.segment(begin,n);//the resampling buffers are free as scratch here
+    auto sOverOmega = _xDotNext.segment(begin,n), cOverOmega = _yDotNext.segment(begin,n);
+    s = (omega*_Ts).sin();
+    c = (omega*_Ts).cos();
+    sOverOmega = (omega.abs() < 1e-4).select(_Ts,s/omega);
+    cOverOmega = (omega.abs() < 1e-4).select(omega*(_Ts*_Ts/2),(1-c)/omega);
+    x += sOverOmega*xDot - cOverOmega*yDot;
+    y += cOverOmega*xDot + sOverOmega*yDot;
+    auto xDotNew = _omegaNext.segment(begin,n);
+    xDotNew = c*xDot - s*yDot;
+    yDot = s*xDot + c*yDot;
+    xDot = xDotNew;
+
+    /*white acceleration noise, stronger in the CT mode*/
+    auto sigmaA = _cumulativeWeight.segment(begin,n);
+    sigmaA = _sigmaAccelerationCV + (_sigmaAccelerationCT-_sigmaAccelerationCV)*_mode.segment(begin,n).cast<DataType>();
+    x += (.5*_Ts*_Ts)*sigmaA*_noise1.segment(begin,n);
+    xDot += _Ts*sigmaA*_noise1.segment(begin,n);
+    y += (.5*_Ts*_Ts)*sigmaA*_noise2.segment(begin,n);
+    yDot += _Ts*sigmaA*_noise2.segment(begin,n);
+  });
+}
+
+void ParticleFilter::Weigh(MeasurementVector z) {
+  double sinTheta = sin(z(1)), cosTheta = cos(z(1));
+  double rangeInformation = 1/(_sigmaR*_sigmaR), azimuthInformation = 1/(_sigmaTheta*_sigmaTheta);
+  ParallelFor([&](int,int begin,int end) {
+    int n = end-begin;
+    auto dx = _noise1.segment(begin,n), dy = _noise2.segment(begin,n), rangeResidual = _noise3.segment(begin,n);
+    auto azimuthResidual = _uniform.segment(begin,n);
+    dx = _x.segment(begin,n) - _sensorState(0);
+    dy = _y.segment(begin,n) - _sensorState(2);
+    rangeResidual = z(0) - (dx*dx + dy*dy).sqrt();
+    /*angle between the predicted and measured bearings, from their cross and dot products*/
+    azimuthResidual = (dy*cosTheta - dx*sinTheta).binaryExpr(dx*cosTheta + dy*sinTheta,
+                                                             [](double cross, double dot) { return atan2(cross,dot); });
+    _logWeight.segment(begin,n) -= .5*(rangeInformation*rangeResidual.square() +
+                                       azimuthInformation*azimuthResidual.square());
+  });
+}
+
+void ParticleFilter::Normalize() {
+  vector<double> partial(_numChunks);
+  ParallelFor([&](int chunk,int begin,int end) {
+    partial[chunk] = _logWeight.segment(begin,end-begin).maxCoeff();
+  });
+  double maxLogWeight = *max_element(partial.begin(),partial.end());
+  ParallelFor([&](int chunk,int begin,int end) {
+    auto w = _weight.segment(begin,end-begin);
+    w = (_logWeight.segment(begin,end-begin) - maxLogWeight).exp();
+    partial[chunk] = w.sum();
+  });
+  double total = 0;
+  for(double p:partial) total += p;
+  double logTotal = maxLogWeight + log(total);
+  ParallelFor([&](int chunk,int begin,int end) {
+    _weight.segment(begin,end-begin) /= total;
+    _logWeight.segment(begin,end-begin) -= logTotal;
+    partial[chunk] = _weight.segment(begin,end-begin).square().sum();
+  });
+  double sumOfSquares = 0;
+  for(double p:partial) sumOfSquares += p;
+  _effectiveSampleSize = 1/sumOfSquares;
+}
+
+/*Systematic resampling. The cumulative weights are built with a two level prefix sum (chunk-local scans, then a scan
+ * over the chunk totals), after which every chunk finds its first ancestor by binary search and walks its own share of
+ * the evenly spaced pointers.*/
+void ParticleFilter::Resample() {
+  vector<double> partial(_numChunks), offset(_numChunks);
+  ParallelFor([&](int chunk,int begin,int end) {
+    double running = 0;
+    for(int i = begin;i<end;i++) {
+      running += _weight(i);
+      _cumulativeWeight(i) = running;
+    }
+    partial[chunk] = running;
+  });
+  double total = 0;
+  for(int c = 0;c<_numChunks;c++) {
+    offset[c] = total;
+    total += partial[c];
+  }
+  double step = total/_numParticles;
+  double u0 = uniform_real_distribution<double>(0,step)(_generators[0]);
+  ParallelFor([&](int chunk,int begin,int end) {
+    _cumulativeWeight.segment(begin,end-begin) += offset[chunk];
+  });
+  ParallelFor([&](int,int begin,int end) {
+    const double* cumulative = _cumulativeWeight.data();
+    int j = int(upper_bound(cumulative,cumulative+_numParticles,u0+begin*step) - cumulative);
+    for(int k = begin;k<end;k++) {
+      double u = u0 + k*step;
+      while(j < _numParticles-1 && cumulative[j] <= u) j++;
+      j = min(j,_numParticles-1);
+      _ancestor(k) = j;
+      _xNext(k) = _x(j);
+      _xDotNext(k) = _xDot(j);
+      _yNext(k) = _y(j);
+      _yDotNext(k) = _yDot(j);
+      _omegaNext(k) = _omega(j);
+      _modeNext(k) = _mode(j);
+    }
+  });
+  _x.swap(_xNext);
+  _xDot.swap(_xDotNext);
+  _y.swap(_yNext);
+  _yDot.swap(_yDotNext);
+  _omega.swap(_omegaNext);
+  _mode.swap(_modeNext);
+  _logWeight.setConstant(-log(double(_numParticles)));
+  _weight.setConstant(1.0/_numParticles);
+  _effectiveSampleSize = _numParticles;
+}
+
+void ParticleFilter::Estimate() {
+  vector<StateVector> partialMean(_numChunks);
+  vector<StateCovarianceMatrix> partialCovariance(_numChunks);
+  vector<double> partialMode(_numChunks);
+  ParallelFor([&](int chunk,int begin,int end) {
+    int n = end-begin;
+    auto w = _weight.segment(begin,n);
+    partialMean[chunk] << (w*_x.segment(begin,n)).sum(), (w*_xDot.segment(begin,n)).sum(),
+                          (w*_y.segment(begin,n)).sum(), (w*_yDot.segment(begin,n)).sum(),
+                          (w*_omega.segment(begin,n)).sum();
+    partialMode[chunk] = (w*_mode.segment(begin,n).cast<DataType>()).sum();
+  });
+  _xEstimate.setZero();
+  _MOD2PR = 0;
+  for(int c = 0;c<_numChunks;c++) {
+    _xEstimate += partialMean[c];
+    _MOD2PR += partialMode[c];
+  }
+  /*second pass about the mean, positions are large compared to their spread*/
+  ParallelFor([&](int chunk,int begin,int end) {
+    StateCovarianceMatrix P = StateCovarianceMatrix::Zero();
+    for(int i = begin;i<end;i++) {
+      StateVector d;
+      d << _x(i)-_xEstimate(0), _xDot(i)-_xEstimate(1), _y(i)-_xEstimate(2), _yDot(i)-_xEstimate(3),
+           _omega(i)-_xEstimate(4);
+      P.noalias() += _weight(i)*d*d.transpose();
+    }
+    partialCovariance[chunk] = P;
+  });
+  _PEstimate.setZero();
+  for(auto& P:partialCovariance) _PEstimate += P;
+}
+
+pair<StateVector,StateCovarianceMatrix> ParticleFilter::Update(const ConvertedMeasurement& measurement) {
+  return Update(measurement.polar);
+}
+
+pair<StateVector,StateCovarianceMatrix> ParticleFilter::GetEstimate() {
+  return make_pair(_xEstimate,_PEstimate);
+}
+
+MeasurementVector ParticleFilter::GetRealZ() {
+  return _zReal;
+}
+
+double ParticleFilter::GetMOD2PR() {
+  return _MOD2PR;
+}
+
+double ParticleFilter::GetEffectiveSampleSize() {
+  return _effectiveSampleSize;
+}
+
+int ParticleFilter::GetNumParticles() {
+  return _numParticles;
+}
@@ -4,6 +4,8 @@
 
 #include "../include/PerformanceEvaluator.h"
 
+#include <limits>
+
 PerformanceEvaluator::PerformanceEvaluator(string filepath):PerformanceEvaluator(){
   SetFilePath(filepath);
 }
@@ -79,7 +81,17 @@ PerformanceEvaluator::PerformanceEvaluator(){
                                                  FinishFunction([=](VecPtr vec) {
                                                    return CalculateRM(vec);
                                                  }));
-
+  /*Tails need the whole distribution, these are sketched instead of summed*/
+  _distributions["POS"] = make_pair(vector<QuantileSketch>(),PerformanceFunction([=](SVref xEst,SCMref P,SVref xReal) {
+                                                  return CalculatePOS(xEst,P,xReal);
+                                                }));
+  _distributions["NEES"] = make_pair(vector<QuantileSketch>(),PerformanceFunction([=](SVref xEst,SCMref P,SVref xReal) {
+                                                  return CalculateNEES(xEst,P,xReal);
+                                                }));
+  _quantiles = {.05,.5,.95,.99};
+  /*Per trial time averages, for confidence intervals over trials*/
+  _runSums["RMSPOS"] = 0;
+  _runSums["NEES"] = 0;
 }
 
 void PerformanceEvaluator::EvaluateIntermediate(pair<StateVector,StateCovarianceMatrix> estimate,
@@ -92,48 +104,198 @@ void PerformanceEvaluator::EvaluateIntermediate(pair<StateVector,StateCovariance
   StateVector zTemp;
   zTemp << z(0),0,z(1),0,0;
 
-  for(auto v:_performanceValueTuples) {
-    string key = v.first;
-    VecPtr vec = get<0>(v.second);//get the vector
-    PerformanceFunction f = get<1>(v.second);//get the performance function
-    if (_runCount == 0) {
-      if(key == "MOD2PR"){vec->push_back(MOD2PR);}
-      else if(key=="RAWRMSPOS"){vec->push_back(f(zTemp,P,xReal));}
-      else{vec->push_back(f(xEst, P, xReal));}
-    }
-    else {
-      if(key == "MOD2PR"){(*vec)[_sampleCount]+=MOD2PR;}
-      else if(key=="RAWRMSPOS"){(*vec)[_sampleCount]+=f(zTemp,P,xReal);}
-      else{ (*vec)[_sampleCount] += f(xEst, P, xReal);} //then we can perform addition assignment
+  for(const auto& v:_performanceValueTuples) {
+    const string& key = v.first;
+    const VecPtr& vec = get<0>(v.second);//get the vector
+    const PerformanceFunction& f = get<1>(v.second);//get the performance function
+    double value;
+    if(key == "MOD2PR"){value = MOD2PR;}
+    else if(key=="RAWRMSPOS"){value = f(zTemp,P,xReal);}
+    else{value = f(xEst, P, xReal);}
+    if (_runCount == 0) {vec->push_back(value);}
+    else {(*vec)[_sampleCount] += value;} //then we can perform addition assignment
+    auto runSum = _runSums.find(key);
+    if(runSum != _runSums.end()) runSum->second += value;
+  }
+  for(auto& d:_distributions) {
+    auto& sketches = d.second.first;
+    if(_runCount == 0) {
+      if(_sampleCount == 0) sketches.clear();
+      sketches.emplace_back();
     }
+    sketches[_sampleCount].Add(d.second.second(xEst,P,xReal));
   }
   _sampleCount++;
 }
 
-void PerformanceEvaluator::FinishEvaluatingRun() {
+void PerformanceEvaluator::FinishEvaluatingRun(const map<string,double>& controls) {
+  for(auto& runSum:_runSums) {
+    double average = runSum.second/_sampleCount;
+    runSum.second = 0;
+    auto control = controls.find(runSum.first);
+    double c = control != controls.end() ? control->second : 0;
+    if(_pairedRuns) {
+      auto& pending = _pendingRun[runSum.first];
+      if(!_pairOpen) {
+        pending = make_pair(average,c);
+        continue;
+      }
+      average = (pending.first+average)/2;
+      c = (pending.second+c)/2;
+    }
+    _trialStatistics[runSum.first].Add(average);
+    if(control != controls.end()) _controlledStatistics[runSum.first].Add(average,c);
+  }
+  if(_pairedRuns) _pairOpen = !_pairOpen;
   _sampleCount = 0;
   _runCount++;
 }
 
 void PerformanceEvaluator::CalculateFinalResults() {
-  for(auto x:_performanceValueTuples) {
-    auto vec = get<0>(x.second);//get the vector
-    auto f = get<2>(x.second);//get the final function
+  for(const auto& x:_performanceValueTuples) {
+    const auto& vec = get<0>(x.second);//get the vector
+    const auto& f = get<2>(x.second);//get the final function
     f(vec);//apply the final operation i.e. compute the rest of RM, RMS, or average
 
   }
 }
 
 void PerformanceEvaluator::WriteResultsToFile() {
-  for(auto x:_performanceValueTuples) {
+  for(const auto& x:_performanceValueTuples) {
     ofstream of(_filepath+x.first+".txt");//open the file
-    auto vec = get<0>(x.second);//get the vector
+    const auto& vec = get<0>(x.second);//get the vector
     for(auto d:*vec)of<<d<<endl;//write the vector into the file
     of.close();//close the file
   }
+  for(auto& d:_distributions) {//one line per time step, one column per quantile
+    ofstream of(_filepath+d.first+"QUANTILES.txt");
+    for(auto& sketch:d.second.first) {
+      for(size_t i = 0;i<_quantiles.size();i++) of<<(i ? "," : "")<<sketch.Quantile(_quantiles[i]);
+      of<<endl;
+    }
+  }
   _runCount = 0;
 }
 
+vector<double> PerformanceEvaluator::GetResult(string key) {
+  return *get<0>(_performanceValueTuples.at(key));
+}
+
+vector<double> PerformanceEvaluator::GetQuantile(string key, double q) {
+  vector<double> result;
+  for(auto& sketch:_distributions.at(key).first) result.push_back(sketch.Quantile(q));
+  return result;
+}
+
+const RunningStatistics& PerformanceEvaluator::GetTrialStatistics(string key) {
+  return _trialStatistics[key];
+}
+
+const ControlledStatistics& PerformanceEvaluator::GetControlledStatistics(string key) {
+  return _controlledStatistics[key];
+}
+
+void PerformanceEvaluator::SetPairedRuns(bool paired) {
+  _pairedRuns = paired;
+  _pairOpen = false;
+}
+
+vector<pair<string,vector<double>>> PerformanceEvaluator::GetColumns() {
+  vector<pair<string,vector<double>>> columns;
+  for(auto& x:_performanceValueTuples) columns.push_back(make_pair(x.first,*get<0>(x.second)));
+  for(auto& d:_distributions) {
+    for(double q:_quantiles) {
+      ostringstream name;
+      name<<d.first<<"_p"<<q*100;
+      columns.push_back(make_pair(name.str(),GetQuantile(d.first,q)));
+    }
+  }
+  return columns;
+}
+
+void PerformanceEvaluator::SaveState(ostream& os) {
+  WriteBinary<int32_t>(os,int32_t(_runCount));
+  WriteBinary<int32_t>(os,int32_t(_sampleCount));
+  WriteBinary<uint32_t>(os,_performanceValueTuples.size());
+  for(auto& x:_performanceValueTuples) {
+    WriteString(os,x.first);
+    WriteVector(os,*get<0>(x.second));
+  }
+  WriteBinary<uint32_t>(os,_distributions.size());
+  for(auto& d:_distributions) {
+    WriteString(os,d.first);
+    WriteBinary<uint64_t>(os,d.second.first.size());
+    for(auto& sketch:d.second.first) sketch.SaveState(os);
+  }
+  WriteBinary<uint32_t>(os,_trialStatistics.size());
+  for(auto& t:_trialStatistics) {
+    WriteString(os,t.first);
+    t.second.SaveState(os);
+  }
+  WriteBinary<uint32_t>(os,_controlledStatistics.size());
+  for(auto& t:_controlledStatistics) {
+    WriteString(os,t.first);
+    t.second.SaveState(os);
+  }
+}
+
+void PerformanceEvaluator::LoadState(istream& is) {
+  _runCount = ReadBinary<int32_t>(is);
+  _sampleCount = ReadBinary<int32_t>(is);
+  uint32_t count = ReadBinary<uint32_t>(is);
+  for(uint32_t i = 0;i<count;i++) {
+    string key = ReadString(is);
+    auto it = _performanceValueTuples.find(key);
+    if(it == _performanceValueTuples.end()) throw runtime_error("unknown performance value " + key);
+    *get<0>(it->second) = ReadVector(is);
+  }
+  count = ReadBinary<uint32_t>(is);
+  for(uint32_t i = 0;i<count;i++) {
+    string key = ReadString(is);
+    auto it = _distributions.find(key);
+    if(it == _distributions.end()) throw runtime_error("unknown distribution " + key);
+    it->second.first.resize(ReadBinary<uint64_t>(is));
+    for(auto& sketch:it->second.first) sketch.LoadState(is);
+  }
+  _trialStatistics.clear();
+  count = ReadBinary<uint32_t>(is);
+  for(uint32_t i = 0;i<count;i++) {
+    string key = ReadString(is);
+    _trialStatistics[key].LoadState(is);
+  }
+  _controlledStatistics.clear();
+  count = ReadBinary<uint32_t>(is);
+  for(uint32_t i = 0;i<count;i++) {
+    string key = ReadString(is);
+    _controlledStatistics[key].LoadState(is);
+  }
+}
+
+void PerformanceEvaluator::Merge(PerformanceEvaluator& other) {
+  if(other._runCount == 0) return;
+  for(auto& x:_performanceValueTuples) {
+    auto vec = get<0>(x.second);
+    auto otherVec = get<0>(other._performanceValueTuples.at(x.first));
+    if(_runCount == 0) *vec = *otherVec;
+    else {
+      if(vec->size() != otherVec->size()) throw runtime_error("cannot merge runs of different lengths");
+      for(size_t i = 0;i<vec->size();i++) (*vec)[i] += (*otherVec)[i];
+    }
+  }
+  for(auto& d:_distributions) {
+    auto& sketches = d.second.first;
+    auto& otherSketches = other._distributions.at(d.first).first;
+    if(_runCount == 0) sketches = otherSketches;
+    else {
+      if(sketches.size() != otherSketches.size()) throw runtime_error("cannot merge runs of different lengths");
+      for(size_t i = 0;i<sketches.size();i++) sketches[i].Merge(otherSketches[i]);
+    }
+  }
+  for(auto& t:other._trialStatistics) _trialStatistics[t.first].Merge(t.second);
+  for(auto& t:other._controlledStatistics) _controlledStatistics[t.first].Merge(t.second);
+  _runCount += other._runCount;
+}
+
 void PerformanceEvaluator::SetFilePath(string filepath) {
   _filepath = filepath;
 }
@@ -191,7 +353,19 @@ double PerformanceEvaluator::CalculateCRS(SVref xEst,SCMref P,SVref xReal) {
 
 double PerformanceEvaluator::CalculateNEES(SVref xEst,SCMref P,SVref xReal) {
   StateVector x = xReal - xEst;
-  double NEES = x.transpose()*P.inverse()*x;
+  //states a model doesn't carry (omega in CV) are embedded with zero variance, so evaluate over the ones it does.
+  //A mode whose probability underflowed leaves denormal variances behind, those aren't carried either
+  Matrix<DataType,Dynamic,1,0,NUM_STATES,1> xCarried(NUM_STATES);
+  Matrix<DataType,Dynamic,Dynamic,0,NUM_STATES,NUM_STATES> PCarried(NUM_STATES,NUM_STATES);
+  int carried[NUM_STATES], n = 0;
+  for(int i = 0;i<NUM_STATES;i++) if(P(i,i) >= numeric_limits<DataType>::min()) carried[n++] = i;
+  xCarried.resize(n);
+  PCarried.resize(n,n);
+  for(int i = 0;i<n;i++) {
+    xCarried(i) = x(carried[i]);
+    for(int j = 0;j<n;j++) PCarried(i,j) = P(carried[i],carried[j]);
+  }
+  double NEES = xCarried.transpose()*PCarried.inverse()*xCarried;
   return NEES;
 }
 
@@ -0,0 +1,107 @@
+//
+// Created by clancy on 5/3/16.
+//
+
+#include "../include/PrecisionHarness.h"
+#include "../include/IMM.h"
+#include "../include/MotionModels.h"
+#include "../include/Target.h"
+#include "../include/RangeSensor.h"
+#include "../include/AzimuthSensor.h"
+
+#include <iomanip>
+
+namespace {
+
+struct BankEvaluators {
+  PerformanceEvaluator immCT, immL, kf;
+};
+
+template<class PrecisionPolicy>
+void RunTrial(const StudyConfiguration& config,
+              const vector<ConvertedMeasurement>& z,
+              const vector<StateVector>& truth,
+              const unsigned seeds[3],
+              BankEvaluators& pe) {
+  auto kf1 = setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,seeds[0]);
+  auto kf2 = setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,seeds[1]);
+  auto ekf1 = setupCTExtendedKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,seeds[2]);
+  kf1.Initialize(z[0].polar,z[1].polar);
+  ekf1.Initialize(z[0].polar,z[1].polar);
+  kf2.Initialize(z[0].polar,z[1].polar);
+  IMM<PrecisionPolicy> immCT(kf1,ekf1);
+  IMM<PrecisionPolicy> immL(kf1,kf2);
+  for(size_t i = 2;i<z.size();i++) {
+    immCT.Update(z[i]);
+    immL.Update(z[i]);
+    kf2.Update(z[i]);
+    pe.immCT.EvaluateIntermediate(immCT.GetEstimate(),immCT.GetMOD2PR(),immCT.GetRealZ(),truth[i]);
+    pe.immL.EvaluateIntermediate(immL.GetEstimate(),immL.GetMOD2PR(),immL.GetRealZ(),truth[i]);
+    pe.kf.EvaluateIntermediate(kf2.GetEstimate(),0,kf2.GetRealZ(),truth[i]);
+  }
+  for(auto p:{&pe.immCT,&pe.immL,&pe.kf}) p->FinishEvaluatingRun();
+}
+
+bool Report(const string& filter, const string& precision, PerformanceEvaluator& reference, PerformanceEvaluator& pe,
+            double tolerance) {
+  bool pass = true;
+  for(string key:{"RMSPOS","NEES"}) {
+    vector<double> ref = reference.GetResult(key), val = pe.GetResult(key);
+    double maxAbs = 0, maxRel = 0;
+    for(size_t i = 0;i<ref.size();i++) {
+      double diff = abs(val[i]-ref[i]);
+      maxAbs = max(maxAbs,diff);
+      maxRel = max(maxRel,diff/max(abs(ref[i]),1e-12));
+    }
+    if(!(maxRel <= tolerance)) pass = false;//NaNs fail too
+    cout<<setw(6)<<filter<<setw(8)<<precision<<setw(8)<<key
+        <<setw(14)<<maxAbs<<setw(14)<<maxRel<<(maxRel <= tolerance ? "   ok" : "   EXCEEDED")<<endl;
+  }
+  return pass;
+}
+
+}
+
+int ComparePrecisions(const StudyConfiguration& config, double tolerance) {
+  RangeSensor range(config.sensorState,0,config.sigmaR);
+  AzimuthSensor azimuth(config.sensorState,0,config.sigmaTheta);
+  MeasurementConverter converter(config.sensorState,config.sigmaR,config.sigmaTheta);
+  random_device rd;
+  BankEvaluators doubles, singles, mixed;
+
+  for(int j = 0;j<config.numTrials;j++) {
+    /*draw the trial once so that every precision sees the same measurements*/
+    Target target(config.trajectoryFile);
+    vector<MeasurementVector> z;
+    vector<StateVector> truth;
+    for(int i = 0;i<NUM_SAMPLES+1;i++) {
+      MeasurementVector zi;
+      zi(0) = range.Measure(target);
+      zi(1) = azimuth.Measure(target);
+      z.push_back(zi);
+      truth.push_back(target.Sample());
+      target.Advance(config.samplesPerStep);
+    }
+    vector<ConvertedMeasurement> converted = converter.ConvertBatch(z);//once for all precisions and filters
+    unsigned seeds[3] = {rd(),rd(),rd()};
+    RunTrial<DoublePrecision>(config,converted,truth,seeds,doubles);
+    RunTrial<SinglePrecision>(config,converted,truth,seeds,singles);
+    RunTrial<MixedPrecision>(config,converted,truth,seeds,mixed);
+  }
+  for(auto p:{&doubles,&singles,&mixed}) {
+    p->immCT.CalculateFinalResults();
+    p->immL.CalculateFinalResults();
+    p->kf.CalculateFinalResults();
+  }
+
+  cout<<"max deviation from double precision over "<<config.numTrials<<" trials, tolerance "<<tolerance<<endl;
+  cout<<setw(6)<<"filter"<<setw(8)<<"mode"<<setw(8)<<"metric"<<setw(14)<<"max abs"<<setw(14)<<"max rel"<<endl;
+  bool pass = true;
+  pass &= Report("immCT","single",doubles.immCT,singles.immCT,tolerance);
+  pass &= Report("immCT","mixed",doubles.immCT,mixed.immCT,tolerance);
+  pass &= Report("immL","single",doubles.immL,singles.immL,tolerance);
+  pass &= Report("immL","mixed",doubles.immL,mixed.immL,tolerance);
+  pass &= Report("kf","single",doubles.kf,singles.kf,tolerance);
+  pass &= Report("kf","mixed",doubles.kf,mixed.kf,tolerance);
+  return pass ? 0 : 1;
+}
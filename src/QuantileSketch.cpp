@@ -0,0 +1,124 @@
+//
+// Created by clancy on 5/10/16.
+//
+
+#include "../include/QuantileSketch.h"
+#include "../include/BinaryIO.h"
+
+#include <algorithm>
+#include <cmath>
+
+QuantileSketch::QuantileSketch(double compression):
+        _compression(compression),
+        _capacity(size_t(2*ceil(compression))+8){//room for the centroids plus as many buffered points
+  _centroids.reserve(_capacity);
+}
+
+void QuantileSketch::Add(double x) {
+  AddWeighted(x,1);
+}
+
+void QuantileSketch::AddWeighted(double mean, double weight) {
+  if(_count == 0) _min = _max = mean;
+  _min = min(_min,mean);
+  _max = max(_max,mean);
+  _count += weight;
+  if(_centroids.size() == _capacity) Compress();
+  _centroids.push_back(make_pair(mean,weight));
+}
+
+/*Centroids keep their weights, so merging is exact up to the other sketch's own compression*/
+void QuantileSketch::Merge(const QuantileSketch& other) {
+  if(other._count == 0) return;
+  double otherMin = other._min, otherMax = other._max;
+  for(auto& c:other._centroids) AddWeighted(c.first,c.second);
+  _min = min(_min,otherMin);
+  _max = max(_max,otherMax);
+}
+
+/*k(q) = compression/(2 pi)*asin(2q-1); a centroid may span at most one unit of k*/
+double QuantileSketch::ScaleInverse(double k) {
+  k = max(-_compression/4,min(_compression/4,k));
+  return (sin(k*2*M_PI/_compression)+1)/2;
+}
+
+void QuantileSketch::Compress() {
+  if(_sorted == _centroids.size()) return;//nothing buffered since the last compression
+  sort(_centroids.begin(),_centroids.end());
+  size_t out = 0;
+  double weightBefore = 0;
+  double limit = _count*ScaleInverse(_compression/(2*M_PI)*asin(-1.0)+1);
+  for(size_t i = 1;i<_centroids.size();i++) {
+    auto& current = _centroids[out];
+    auto& next = _centroids[i];
+    if(weightBefore+current.second+next.second <= limit) {
+      double weight = current.second+next.second;
+      current.first += (next.first-current.first)*next.second/weight;
+      current.second = weight;
+    }
+    else {
+      weightBefore += current.second;
+      limit = _count*ScaleInverse(_compression/(2*M_PI)*asin(2*weightBefore/_count-1)+1);
+      _centroids[++out] = next;
+    }
+  }
+  _centroids.resize(_centroids.empty() ? 0 : out+1);
+  _sorted = _centroids.size();
+}
+
+/*Linear interpolation between centroid centres, pinned to the exact extremes at both ends*/
+double QuantileSketch::Quantile(double q) {
+  if(_count == 0) return NAN;
+  Compress();
+  double target = q*_count, weightBefore = 0;
+  double previousCentre = 0, previousMean = _min;
+  for(auto& c:_centroids) {
+    double centre = weightBefore + c.second/2;
+    if(target < centre) {
+      double fraction = (target-previousCentre)/(centre-previousCentre);
+      return previousMean + fraction*(c.first-previousMean);
+    }
+    previousCentre = centre;
+    previousMean = c.first;
+    weightBefore += c.second;
+  }
+  if(_count == previousCentre) return _max;
+  return previousMean + (target-previousCentre)/(_count-previousCentre)*(_max-previousMean);
+}
+
+double QuantileSketch::Count() {
+  return _count;
+}
+
+size_t QuantileSketch::NumCentroids() {
+  Compress();
+  return _centroids.size();
+}
+
+/*The buffer as it is, centroids and unsorted points, so saving doesn't change what the sketch reports later*/
+void QuantileSketch::SaveState(ostream& os) const {
+  WriteBinary<double>(os,_compression);
+  WriteBinary<double>(os,_count);
+  WriteBinary<double>(os,_min);
+  WriteBinary<double>(os,_max);
+  vector<double> means, weights;
+  for(auto& c:_centroids) {
+    means.push_back(c.first);
+    weights.push_back(c.second);
+  }
+  WriteVector(os,means);
+  WriteVector(os,weights);
+  WriteBinary<uint64_t>(os,_sorted);
+}
+
+void QuantileSketch::LoadState(istream& is) {
+  *this = QuantileSketch(ReadBinary<double>(is));
+  _count = ReadBinary<double>(is);
+  _min = ReadBinary<double>(is);
+  _max = ReadBinary<double>(is);
+  vector<double> means = ReadVector(is), weights = ReadVector(is);
+  if(means.size() != weights.size() || means.size() > _capacity) throw runtime_error("corrupt quantile sketch");
+  for(size_t i = 0;i<means.size();i++) _centroids.push_back(make_pair(means[i],weights[i]));
+  _sorted = ReadBinary<uint64_t>(is);
+  if(_sorted > _centroids.size()) throw runtime_error("corrupt quantile sketch");
+}
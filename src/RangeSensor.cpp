@@ -13,7 +13,7 @@ double RangeSensor::Measure(Target& aTarget) {
       range += pow(_sensorState(i) - targetState(i), 2);
   }
   range = sqrt(range);
-  double noise = _distribution(_generator);
+  double noise = Noise();
   range += noise;
   return range;
 }
\ No newline at end of file
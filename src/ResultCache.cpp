@@ -0,0 +1,168 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/ResultCache.h"
+#include "../include/BinaryIO.h"
+#include "../include/MonteCarloStudy.h"
+#include "../include/MotionModels.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+/*Bumped whenever the filters, the sensors or the evaluators change what a trial computes, the IMM's fixed transition
+ * matrix included, so that older entries are no longer found. Changes to how the models are built and to the
+ * checkpoint format are caught by the key itself.*/
+const uint32_t cacheVersion = 4;
+
+template<class Derived>
+void WriteMatrix(ostream& os, const MatrixBase<Derived>& m) {
+  for(Index i = 0;i<m.rows();i++) for(Index j = 0;j<m.cols();j++) WriteBinary<double>(os,m(i,j));
+}
+
+template<class Derived>
+void ReadMatrix(istream& is, MatrixBase<Derived>& m) {
+  for(Index i = 0;i<m.rows();i++) for(Index j = 0;j<m.cols();j++) m(i,j) = ReadBinary<double>(is);
+}
+
+/*What the setup functions build from the configuration*/
+template<class Filter>
+void WriteModel(ostream& os, const Filter& filter) {
+  const typename Filter::Model& model = *filter.GetModel();
+  WriteBinary<uint64_t>(os,model.fingerprint);
+  WriteMatrix(os,model.H);
+  WriteMatrix(os,model.Q);
+  WriteBinary<int32_t>(os,int32_t(model.structure));
+}
+
+/*The bank's models, and every radar's with --distributed*/
+void WriteModels(ostream& os, const StudyConfiguration& config) {
+  WriteModel(os,setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0));
+  WriteModel(os,setupCVKalmanFilter(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0));
+  WriteModel(os,setupCTExtendedKalmanFilter(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,0));
+  if(config.distributed) {
+    for(auto& site:config.network) {
+      WriteModel(os,setupCVKalmanFilter(site.sensorState,config.Ts,config.V1,site.sigmaR,site.sigmaTheta,0));
+      WriteModel(os,setupCTExtendedKalmanFilter(site.sensorState,config.Ts,config.V3,site.sigmaR,site.sigmaTheta,0));
+    }
+  }
+}
+
+uint64_t FNV1a(const string& bytes) {
+  uint64_t hash = 14695981039346656037ull;
+  for(unsigned char c:bytes) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+}
+
+void WriteStudySettings(ostream& os, const StudyConfiguration& config) {
+  WriteMatrix(os,config.sensorState);
+  WriteBinary<double>(os,config.sigmaR);
+  WriteBinary<double>(os,config.sigmaTheta);
+  WriteBinary<double>(os,config.Ts);
+  WriteBinary<int32_t>(os,config.samplesPerStep);
+  WriteMatrix(os,config.V1);
+  WriteMatrix(os,config.V2);
+  WriteMatrix(os,config.V3);
+  WriteBinary<uint8_t>(os,config.antithetic);
+  WriteBinary<uint8_t>(os,config.controlVariates);
+  WriteBinary<uint8_t>(os,config.runParticleFilter);
+  if(config.runParticleFilter) {
+    WriteBinary<int32_t>(os,config.numParticles);
+    WriteBinary<double>(os,config.pfSigmaAccelerationCV);
+    WriteBinary<double>(os,config.pfSigmaAccelerationCT);
+    WriteBinary<double>(os,config.pfSigmaOmega);
+  }
+  WriteBinary<uint8_t>(os,config.clutter);
+  if(config.clutter) {
+    for(double value:{config.falseAlarmRate,config.Pd,config.Pg,config.clutterRMin,config.clutterRMax,
+                      config.clutterThetaMin,config.clutterThetaMax}) {
+      WriteBinary<double>(os,value);
+    }
+  }
+  WriteBinary<double>(os,config.missProbability);
+  WriteBinary<uint8_t>(os,config.distributed);
+  if(config.distributed) WriteBinary<double>(os,config.fusionGate);
+  WriteBinary<uint32_t>(os,config.network.size());
+  for(auto& site:config.network) {
+    WriteMatrix(os,site.sensorState);
+    WriteBinary<double>(os,site.sigmaR);
+    WriteBinary<double>(os,site.sigmaTheta);
+  }
+}
+
+void ReadStudySettings(istream& is, StudyConfiguration& config) {
+  ReadMatrix(is,config.sensorState);
+  config.sigmaR = ReadBinary<double>(is);
+  config.sigmaTheta = ReadBinary<double>(is);
+  config.Ts = ReadBinary<double>(is);
+  config.samplesPerStep = ReadBinary<int32_t>(is);
+  ReadMatrix(is,config.V1);
+  ReadMatrix(is,config.V2);
+  ReadMatrix(is,config.V3);
+  config.antithetic = ReadBinary<uint8_t>(is);
+  config.controlVariates = ReadBinary<uint8_t>(is);
+  config.runParticleFilter = ReadBinary<uint8_t>(is);
+  if(config.runParticleFilter) {
+    config.numParticles = ReadBinary<int32_t>(is);
+    config.pfSigmaAccelerationCV = ReadBinary<double>(is);
+    config.pfSigmaAccelerationCT = ReadBinary<double>(is);
+    config.pfSigmaOmega = ReadBinary<double>(is);
+  }
+  config.clutter = ReadBinary<uint8_t>(is);
+  if(config.clutter) {
+    for(double* value:{&config.falseAlarmRate,&config.Pd,&config.Pg,&config.clutterRMin,&config.clutterRMax,
+                       &config.clutterThetaMin,&config.clutterThetaMax}) {
+      *value = ReadBinary<double>(is);
+    }
+  }
+  config.missProbability = ReadBinary<double>(is);
+  config.distributed = ReadBinary<uint8_t>(is);
+  if(config.distributed) config.fusionGate = ReadBinary<double>(is);
+  config.network.resize(ReadBinary<uint32_t>(is));
+  for(auto& site:config.network) {
+    ReadMatrix(is,site.sensorState);
+    site.sigmaR = ReadBinary<double>(is);
+    site.sigmaTheta = ReadBinary<double>(is);
+  }
+}
+
+uint64_t StudyHash(const StudyConfiguration& config) {
+  ifstream trajectory(config.trajectoryFile,ios::binary);
+  if(!trajectory) throw runtime_error("could not read " + config.trajectoryFile);
+  ostringstream contents;
+  contents<<trajectory.rdbuf();
+
+  ostringstream image;
+  WriteBinary<uint32_t>(image,cacheVersion);
+  WriteBinary<uint32_t>(image,MonteCarloStudy::CheckpointVersion());
+  WriteModels(image,config);
+  WriteString(image,contents.str());
+  WriteStudySettings(image,config);
+  WriteBinary<uint32_t>(image,config.seed);
+  return FNV1a(image.str());
+}
+
+string ResultCacheKey(const StudyConfiguration& config) {
+  ostringstream key;
+  WriteBinary<uint64_t>(key,StudyHash(config));
+  WriteBinary<int32_t>(key,config.firstTrial);
+  char hex[17];
+  snprintf(hex,sizeof(hex),"%016llx",(unsigned long long)FNV1a(key.str()));
+  return hex;
+}
+
+string ResultCachePath(const StudyConfiguration& config) {
+  if(mkdir(config.cacheDirectory.c_str(),0755) != 0 && errno != EEXIST) {
+    throw runtime_error("could not create the cache directory " + config.cacheDirectory);
+  }
+  return config.cacheDirectory + "/" + ResultCacheKey(config) + ".ckpt";
+}
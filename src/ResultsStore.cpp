@@ -0,0 +1,144 @@
+//
+// Created by clancy on 5/15/16.
+//
+
+#include "../include/ResultsStore.h"
+#include "../include/BinaryIO.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+const string storeMagic = "ETPRSLT";
+const uint32_t storeVersion = 1;
+
+template<typename T>
+string ToString(const T& value) {
+  ostringstream text;
+  text.precision(17);
+  text<<value;
+  return text.str();
+}
+
+template<typename Derived>
+string MatrixToString(const MatrixBase<Derived>& m) {
+  IOFormat myFormat(FullPrecision, DontAlignCols, " ", ";", "", "", "[", "]");
+  ostringstream text;
+  text<<m.format(myFormat);
+  return text.str();
+}
+}
+
+void ResultsStore::AddMetadata(string key, string value) {
+  _metadata.push_back(make_pair(key,value));
+}
+
+void ResultsStore::AddConfiguration(const StudyConfiguration& config, int completedTrials) {
+  AddMetadata("trajectoryFile",config.trajectoryFile);
+  AddMetadata("seed",ToString(config.seed));
+  AddMetadata("firstTrial",ToString(config.firstTrial));
+  AddMetadata("trials",ToString(completedTrials));
+  AddMetadata("sensorState",MatrixToString(config.sensorState.transpose()));
+  AddMetadata("sigmaR",ToString(config.sigmaR));
+  AddMetadata("sigmaTheta",ToString(config.sigmaTheta));
+  AddMetadata("Ts",ToString(config.Ts));
+  AddMetadata("samplesPerStep",ToString(config.samplesPerStep));
+  AddMetadata("V1",MatrixToString(config.V1));
+  AddMetadata("V2",MatrixToString(config.V2));
+  AddMetadata("V3",MatrixToString(config.V3));
+  AddMetadata("antithetic",ToString(config.antithetic));
+  AddMetadata("controlVariates",ToString(config.controlVariates));
+  if(config.Adaptive()) {
+    AddMetadata("targetRMSPOS",ToString(config.targetRMSPOS));
+    AddMetadata("targetANEES",ToString(config.targetANEES));
+    AddMetadata("confidence",ToString(config.confidence));
+    AddMetadata("minTrials",ToString(config.minTrials));
+    AddMetadata("trialBudget",ToString(config.numTrials));
+  }
+  AddMetadata("particleFilter",ToString(config.runParticleFilter));
+  if(config.runParticleFilter) AddMetadata("numParticles",ToString(config.numParticles));
+  AddMetadata("networkSensors",ToString(config.network.size()));
+  AddMetadata("distributed",ToString(config.distributed));
+  if(config.distributed) AddMetadata("fusionGate",ToString(config.fusionGate));
+  for(size_t k = 0;k<config.network.size();k++) {
+    const SensorSite& site = config.network[k];
+    AddMetadata("sensor"+ToString(k),MatrixToString(Vector4d(site.sensorState(0),site.sensorState(2),site.sigmaR,
+                                                               site.sigmaTheta).transpose()));
+  }
+  AddMetadata("missProbability",ToString(config.missProbability));
+  AddMetadata("clutter",ToString(config.clutter));
+  if(config.clutter) {
+    AddMetadata("falseAlarmRate",ToString(config.falseAlarmRate));
+    AddMetadata("Pd",ToString(config.Pd));
+    AddMetadata("Pg",ToString(config.Pg));
+  }
+}
+
+void ResultsStore::AddColumn(string name, vector<double> values) {
+  _columns.push_back(make_pair(name,values));
+}
+
+void ResultsStore::AddEvaluator(string filter, PerformanceEvaluator& pe) {
+  for(auto& column:pe.GetColumns()) AddColumn(filter+"/"+column.first,column.second);
+}
+
+/*Written to a temporary file and renamed, like the checkpoints*/
+void ResultsStore::Write(string filename) {
+  uint64_t rows = 0;
+  for(auto& column:_columns) rows = max<uint64_t>(rows,column.second.size());
+  string temporary = filename + ".tmp";
+  {
+    ofstream of(temporary,ios::binary);
+    of.write(storeMagic.data(),storeMagic.size());
+    WriteBinary<uint32_t>(of,storeVersion);
+    WriteBinary<uint32_t>(of,_metadata.size());
+    for(auto& entry:_metadata) {
+      WriteString(of,entry.first);
+      WriteString(of,entry.second);
+    }
+    WriteBinary<uint32_t>(of,_columns.size());
+    WriteBinary<uint64_t>(of,rows);
+    for(auto& column:_columns) WriteString(of,column.first);
+    for(auto& column:_columns) {
+      vector<double> values = column.second;
+      values.resize(rows,NAN);
+      of.write(reinterpret_cast<const char*>(values.data()),rows*sizeof(double));
+    }
+    if(!of) throw runtime_error("could not write results " + temporary);
+  }
+  if(rename(temporary.c_str(),filename.c_str()) != 0) throw runtime_error("could not replace results " + filename);
+}
+
+ResultsStore ResultsStore::Read(string filename) {
+  ifstream in(filename,ios::binary);
+  if(!in) throw runtime_error("could not open results " + filename);
+  string magic(storeMagic.size(),'\0');
+  in.read(&magic[0],magic.size());
+  if(!in || magic != storeMagic || ReadBinary<uint32_t>(in) != storeVersion) {
+    throw runtime_error(filename + " is not a results store of this version");
+  }
+  ResultsStore store;
+  uint32_t count = ReadBinary<uint32_t>(in);
+  for(uint32_t i = 0;i<count;i++) {
+    string key = ReadString(in);
+    store.AddMetadata(key,ReadString(in));
+  }
+  count = ReadBinary<uint32_t>(in);
+  uint64_t rows = ReadBinary<uint64_t>(in);
+  for(uint32_t i = 0;i<count;i++) store.AddColumn(ReadString(in),vector<double>(rows));
+  for(auto& column:store._columns) {
+    if(!in.read(reinterpret_cast<char*>(column.second.data()),rows*sizeof(double))) {
+      throw runtime_error("unexpected end of results " + filename);
+    }
+  }
+  return store;
+}
+
+const vector<pair<string,string>>& ResultsStore::GetMetadata() {
+  return _metadata;
+}
+
+const vector<pair<string,vector<double>>>& ResultsStore::GetColumns() {
+  return _columns;
+}
@@ -0,0 +1,121 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/RunningStatistics.h"
+#include "../include/BinaryIO.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/*Two sided: the normal quantile by bisection on erfc, then the Cornish-Fisher expansion of the t quantile in 1/dof,
+ * which is within 1e-3 of the exact value from 9 degrees of freedom up*/
+double StudentQuantile(double confidence, double dof) {
+  double p = (1+confidence)/2, lo = 0, hi = 10;
+  for(int i = 0;i<60;i++) {
+    double mid = (lo+hi)/2;
+    if(.5*erfc(-mid/sqrt(2.0)) < p) lo = mid;
+    else hi = mid;
+  }
+  double z = (lo+hi)/2, z2 = z*z;
+  return z + z*(z2+1)/(4*dof) + z*((5*z2+16)*z2+3)/(96*dof*dof) + z*(((3*z2+19)*z2+17)*z2-15)/(384*dof*dof*dof);
+}
+}
+
+void RunningStatistics::Add(double x) {
+  _count++;
+  double delta = x - _mean;
+  _mean += delta/_count;
+  _m2 += delta*(x - _mean);
+}
+
+void RunningStatistics::Merge(const RunningStatistics& other) {
+  if(other._count == 0) return;
+  double count = _count + other._count, delta = other._mean - _mean;
+  _mean += delta*other._count/count;
+  _m2 += other._m2 + delta*delta*_count*other._count/count;
+  _count = count;
+}
+
+double RunningStatistics::Count() const {
+  return _count;
+}
+
+double RunningStatistics::Mean() const {
+  return _count > 0 ? _mean : NAN;
+}
+
+double RunningStatistics::Variance() const {
+  return _count > 1 ? _m2/(_count-1) : NAN;
+}
+
+double RunningStatistics::HalfWidth(double confidence) const {
+  if(_count < 2) return NAN;
+  return StudentQuantile(confidence,_count-1)*sqrt(Variance()/_count);
+}
+
+void RunningStatistics::SaveState(ostream& os) {
+  WriteBinary<double>(os,_count);
+  WriteBinary<double>(os,_mean);
+  WriteBinary<double>(os,_m2);
+}
+
+void RunningStatistics::LoadState(istream& is) {
+  _count = ReadBinary<double>(is);
+  _mean = ReadBinary<double>(is);
+  _m2 = ReadBinary<double>(is);
+}
+
+void ControlledStatistics::Add(double y, double c) {
+  _count++;
+  double deltaY = y - _meanY, deltaC = c - _meanC;
+  _meanY += deltaY/_count;
+  _meanC += deltaC/_count;
+  _m2Y += deltaY*(y - _meanY);
+  _m2C += deltaC*(c - _meanC);
+  _m2YC += deltaY*(c - _meanC);
+}
+
+void ControlledStatistics::Merge(const ControlledStatistics& other) {
+  if(other._count == 0) return;
+  double count = _count + other._count, deltaY = other._meanY - _meanY, deltaC = other._meanC - _meanC;
+  double weight = _count*other._count/count;
+  _meanY += deltaY*other._count/count;
+  _meanC += deltaC*other._count/count;
+  _m2Y += other._m2Y + deltaY*deltaY*weight;
+  _m2C += other._m2C + deltaC*deltaC*weight;
+  _m2YC += other._m2YC + deltaY*deltaC*weight;
+  _count = count;
+}
+
+double ControlledStatistics::Count() const {
+  return _count;
+}
+
+double ControlledStatistics::Beta() const {
+  return _m2C > 0 ? _m2YC/_m2C : 0;
+}
+
+double ControlledStatistics::Correlation() const {
+  return _m2Y > 0 && _m2C > 0 ? _m2YC/sqrt(_m2Y*_m2C) : NAN;
+}
+
+double ControlledStatistics::Mean() const {
+  return _count > 0 ? _meanY - Beta()*_meanC : NAN;
+}
+
+double ControlledStatistics::HalfWidth(double confidence) const {
+  if(_count < 3) return NAN;
+  double residual = max(0.0,_m2Y - Beta()*_m2YC)/(_count-2);
+  double leverage = 1/_count + (_m2C > 0 ? _meanC*_meanC/_m2C : 0);
+  return StudentQuantile(confidence,_count-2)*sqrt(residual*leverage);
+}
+
+void ControlledStatistics::SaveState(ostream& os) {
+  for(double value:{_count,_meanY,_meanC,_m2Y,_m2C,_m2YC}) WriteBinary<double>(os,value);
+}
+
+void ControlledStatistics::LoadState(istream& is) {
+  for(double* value:{&_count,&_meanY,&_meanC,&_m2Y,&_m2C,&_m2YC}) *value = ReadBinary<double>(is);
+}
@@ -0,0 +1,92 @@
+//
+// Created by clancy on 5/16/16.
+//
+
+#include "../include/SensorNetwork.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+SensorNetwork::SensorNetwork(const vector<SensorSite>& sites) {
+  for(auto& site:sites) AddSensor(site);
+}
+
+int SensorNetwork::AddSensor(const SensorSite& site) {
+  _sites.push_back(site);
+  _converters.push_back(MeasurementConverter(site.sensorState,site.sigmaR,site.sigmaTheta));
+  _range.emplace_back(new RangeSensor(site.sensorState,0,site.sigmaR));
+  _azimuth.emplace_back(new AzimuthSensor(site.sensorState,0,site.sigmaTheta));
+  return int(_sites.size())-1;
+}
+
+int SensorNetwork::Size() const {
+  return int(_sites.size());
+}
+
+const SensorSite& SensorNetwork::GetSite(int sensor) const {
+  return _sites.at(sensor);
+}
+
+const MeasurementConverter& SensorNetwork::GetConverter(int sensor) const {
+  return _converters.at(sensor);
+}
+
+void SensorNetwork::Seed(unsigned seed, bool antithetic) {
+  for(int k = 0;k<Size();k++) {
+    seed_seq sensorSeeds{seed,unsigned(k)};
+    uint32_t streamSeeds[2];
+    sensorSeeds.generate(streamSeeds,streamSeeds+2);
+    _range[k]->Seed(streamSeeds[0],antithetic);
+    _azimuth[k]->Seed(streamSeeds[1],antithetic);
+  }
+}
+
+void SensorNetwork::Measure(Target& aTarget, vector<SensorMeasurement>& measurements) {
+  measurements.resize(_sites.size());
+  for(int k = 0;k<Size();k++) {
+    measurements[k].sensor = k;
+    measurements[k].z(0) = _range[k]->Measure(aTarget);
+    measurements[k].z(1) = _azimuth[k]->Measure(aTarget);
+  }
+}
+
+ConvertedMeasurement SensorNetwork::Fuse(const vector<SensorMeasurement>& measurements) const {
+  if(measurements.empty()) throw invalid_argument("nothing to fuse");
+  MeasurementCovarianceMatrix information = MeasurementCovarianceMatrix::Zero();
+  MeasurementVector informationState = MeasurementVector::Zero();
+  for(auto& measurement:measurements) {
+    ConvertedMeasurement converted = GetConverter(measurement.sensor).Convert(measurement.z);
+    const MeasurementCovarianceMatrix& R = converted.R;
+    MeasurementCovarianceMatrix RInverse;
+    RInverse << R(1,1), -R(0,1),
+               -R(1,0), R(0,0);
+    RInverse /= R(0,0)*R(1,1) - R(0,1)*R(1,0);
+    information += RInverse;
+    informationState += RInverse*converted.z;
+  }
+  ConvertedMeasurement fused;
+  fused.R = information.inverse();
+  fused.z = fused.R*informationState;
+  fused.polar = _converters[0].ToPolar(fused.z);
+  return fused;
+}
+
+vector<SensorSite> SensorNetwork::ReadSites(string filename) {
+  ifstream in(filename);
+  if(!in) throw runtime_error("could not open sensor sites " + filename);
+  vector<SensorSite> sites;
+  string line;
+  while(getline(in,line)) {
+    if(line.find_first_not_of(" \t\r") == string::npos || line[0] == '#') continue;
+    for(auto& c:line) if(c == ',') c = ' ';
+    istringstream fields(line);
+    double x, y;
+    SensorSite site;
+    if(!(fields>>x>>y>>site.sigmaR>>site.sigmaTheta)) throw runtime_error("bad sensor site in " + filename + ": " + line);
+    site.sensorState << x, 0, y, 0, 0;
+    sites.push_back(site);
+  }
+  if(sites.empty()) throw runtime_error(filename + " holds no sensor sites");
+  return sites;
+}
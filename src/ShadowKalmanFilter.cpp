@@ -0,0 +1,93 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/ShadowKalmanFilter.h"
+
+#include <cmath>
+#include <stdexcept>
+
+ShadowKalmanFilter::ShadowKalmanFilter(StateVector sensorState, double sigmaR, double sigmaTheta, TimeType Ts,
+                                       CVKalmanFilter<>::ModelVProcessNoiseGainMatrix V):
+        _sensorState(sensorState),
+        _sigmaR(sigmaR),
+        _sigmaTheta(sigmaTheta),
+        _Ts(Ts){
+  Matrix<DataType,CV_STATES,CV_PROCESS_NOISES> Gamma;
+  Gamma << 0.5*Ts*Ts, 0,
+           Ts,        0,
+           0,         0.5*Ts*Ts,
+           0,         Ts;
+  _F << 1, Ts, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, Ts,
+        0, 0, 0, 1;
+  _Q = Gamma*(V*V)*Gamma.transpose();
+  _H << 1, 0, 0, 0,
+        0, 0, 1, 0;
+}
+
+Matrix2d ShadowKalmanFilter::NoiseGain(const StateVector& truth) const {
+  double dx = truth(0)-_sensorState(0), dy = truth(2)-_sensorState(2);
+  double r = sqrt(dx*dx+dy*dy), c = dx/r, s = dy/r;
+  Matrix2d J;
+  J << c, -r*s,
+       s,  r*c;
+  return J;
+}
+
+/*e is the error, m its mean and Sigma its covariance. With d the truth's departure from CV over a step,
+ *   e = (I-KH)(F e - d) + K J n
+ * so m follows the same recursion without the noise and Sigma = A F Sigma F' A' + K R K', A = I-KH. The gains come
+ * from the usual covariance recursion with R at the truth, they only have to be the same in every trial.*/
+map<string,double> ShadowKalmanFilter::Controls(const vector<StateVector>& truth,
+                                                const vector<MeasurementVector>& noise) const {
+  if(truth.size() < 3 || truth.size() != noise.size()) throw invalid_argument("the shadow filter needs a whole run");
+  auto cv = [](const StateVector& x) { return CVVector(x(0),x(1),x(2),x(3)); };
+  Matrix2d polarR;
+  polarR << _sigmaR*_sigmaR, 0,
+            0, _sigmaTheta*_sigmaTheta;
+
+  /*two point differencing*/
+  Matrix2d J0 = NoiseGain(truth[0]), J1 = NoiseGain(truth[1]);
+  CVGainMatrix B0, B1;
+  B0 << 0, 0,
+        -1/_Ts, 0,
+        0, 0,
+        0, -1/_Ts;
+  B1 << 1, 0,
+        1/_Ts, 0,
+        0, 1,
+        0, 1/_Ts;
+  CVVector m = CVVector::Zero();
+  m(1) = (truth[1](0)-truth[0](0))/_Ts - truth[1](1);
+  m(3) = (truth[1](2)-truth[0](2))/_Ts - truth[1](3);
+  CVVector e = m + B1*J1*noise[1] + B0*J0*noise[0];
+  CVMatrix Sigma = B1*J1*polarR*J1.transpose()*B1.transpose() + B0*J0*polarR*J0.transpose()*B0.transpose();
+  CVMatrix P = Sigma;
+
+  double squaredError = 0, expectedSquaredError = 0, NEES = 0;
+  int steps = int(truth.size())-2;
+  for(size_t k = 2;k<truth.size();k++) {
+    Matrix2d J = NoiseGain(truth[k]);
+    Matrix2d R = J*polarR*J.transpose();
+    CVMatrix PPredicted = _F*P*_F.transpose() + _Q;
+    Matrix2d S = _H*PPredicted*_H.transpose() + R;
+    CVGainMatrix K = PPredicted*_H.transpose()*S.inverse();
+    CVMatrix A = CVMatrix::Identity() - K*_H;
+    P = A*PPredicted;
+    CVVector d = cv(truth[k]) - _F*cv(truth[k-1]);
+    m = A*(_F*m - d);
+    e = A*(_F*e - d) + K*J*noise[k];
+    Sigma = A*_F*Sigma*_F.transpose()*A.transpose() + K*R*K.transpose();
+
+    squaredError += e(0)*e(0) + e(2)*e(2);
+    expectedSquaredError += m(0)*m(0) + m(2)*m(2) + Sigma(0,0) + Sigma(2,2);
+    CVVector deviation = e - m;
+    NEES += deviation.dot(Sigma.ldlt().solve(deviation));
+  }
+  map<string,double> controls;
+  controls["RMSPOS"] = (squaredError - expectedSquaredError)/steps;
+  controls["NEES"] = NEES/steps - CV_STATES;
+  return controls;
+}
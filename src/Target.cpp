@@ -4,9 +4,49 @@
 
 #include "../include/Target.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+const TimeType generatorStep = 1;//s between the lines of a dense file
+const double sameTurnRate = 1e-4;//rad/s, the file's 6 digits resolve omega much finer, maneuvers are degrees per second
+}
+
 Target::Target(string dataFile): _dataFile(dataFile){
-  _data = ifstream(_dataFile);
-  Advance();
+  ifstream data(_dataFile);
+  string line;
+  bool dense = true;
+  while(getline(data,line)) {
+    istringstream lineStream(line);
+    vector<double> values;
+    string value;
+    while(getline(lineStream,value,',')) values.push_back(stod(value));
+    if(values.empty()) continue;
+    if(values.size() != NUM_STATES && values.size() != NUM_STATES+1)
+      throw invalid_argument("trajectory lines are x,xDot,y,yDot,omega or t,x,xDot,y,yDot,omega: "+_dataFile);
+    if(_knots.empty()) dense = values.size() == NUM_STATES;
+    else if(dense != (values.size() == NUM_STATES)) throw invalid_argument("mixed dense and timestamped knots: "+_dataFile);
+    TimeType t = dense ? _knots.size()*generatorStep : values[0];
+    if(!_knotTimes.empty() && t <= _knotTimes.back()) throw invalid_argument("knot times must increase: "+_dataFile);
+    _knotTimes.push_back(t);
+    _knots.push_back(Map<StateVector>(values.data()+(dense ? 0 : 1)));
+  }
+  if(_knots.empty()) throw invalid_argument("no trajectory in "+_dataFile);
+
+  /*a knot turns at its stored omega; a dense file's zeros are the generator's, the velocity's rotation has the rate*/
+  for(size_t k = 0;k<_knots.size();k++) {
+    DataType omega = _knots[k](4);
+    if(dense && omega == 0 && k+1 < _knots.size()) {
+      const StateVector &x0 = _knots[k], &x1 = _knots[k+1];
+      omega = atan2(x0(1)*x1(3)-x0(3)*x1(1),x0(1)*x1(1)+x0(3)*x1(3))/(_knotTimes[k+1]-_knotTimes[k]);
+    }
+    else if(dense && omega == 0 && k > 0) omega = _omega[k-1];
+    _omega.push_back(omega);
+  }
+  _time = _knotTimes.front();
 }
 void Target::Print(const string&& message) {
   cout<<move(message)<<endl;
@@ -18,23 +58,60 @@ void Target::Print(const string& message) {
 
 void Target::Advance(int times) {
   for(int i = 0;i<times;i++) {
-    string nextStateString;
-    StateVector nextStateVector;
-    if (getline(_data, nextStateString)) {
-      istringstream nextStateStream(nextStateString);
-      int index = 0;
-      while (getline(nextStateStream, nextStateString, ',')) {
-        nextStateVector(index) = stod(nextStateString);
-        index++;
-      }
-      _state = nextStateVector;
-    }
-    else {
-      _data.close();
-      Print("No more data to read");
-    }
+    if(_time+generatorStep <= _knotTimes.back()) _time += generatorStep;
+    else Print("No more data to read");
   }
 }
 StateVector Target::Sample() {
-  return _state;
-}
\ No newline at end of file
+  return StateAt(_time);
+}
+
+/*Exact coordinated turn from the last knot at or before t (the first one for earlier times), with the generator's
+ * F at omega over tau. 1-cos is written as 2sin^2 so a small omega doesn't cancel. The turn rate in the state is the
+ * one propagated with, so dense and sparse storage of a trajectory give the same truth.*/
+StateVector Target::StateAt(TimeType t) const {
+  size_t k = upper_bound(_knotTimes.begin(),_knotTimes.end(),t)-_knotTimes.begin();
+  k = k > 0 ? k-1 : 0;
+  TimeType tau = t-_knotTimes[k];
+  const StateVector& x = _knots[k];
+  DataType omega = _omega[k], s, c, oneMinusC;
+  if(omega != 0) {
+    s = sin(omega*tau)/omega;
+    oneMinusC = 2*pow(sin(omega*tau/2),2)/omega;
+    c = cos(omega*tau);
+  }
+  else {
+    s = tau;
+    oneMinusC = 0;
+    c = 1;
+  }
+  double sinOmegaTau = omega*s;
+  StateVector state;
+  state << x(0) + s*x(1) - oneMinusC*x(3),
+           c*x(1) - sinOmegaTau*x(3),
+           x(2) + oneMinusC*x(1) + s*x(3),
+           sinOmegaTau*x(1) + c*x(3),
+           omega;
+  return state;
+}
+
+/*Timestamped knots where the turn rate changes, each with the mean rate of its leg, and the last knot so the
+ * trajectory keeps its length*/
+void Target::WriteSparse(string dataFile) const {
+  ofstream out(dataFile);
+  out.precision(numeric_limits<double>::max_digits10);
+  auto write = [&](size_t k, DataType omega) {
+    const StateVector& x = _knots[k];
+    out<<_knotTimes[k]<<","<<x(0)<<","<<x(1)<<","<<x(2)<<","<<x(3)<<","<<omega<<endl;
+  };
+  size_t leg = 0, written = 0;
+  for(size_t k = 1;k<=_knots.size();k++) {
+    if(k < _knots.size() && abs(_omega[k]-_omega[leg]) < sameTurnRate) continue;
+    DataType omega = 0;
+    for(size_t i = leg;i<k;i++) omega += _omega[i];
+    write(leg,omega/(k-leg));
+    written = leg;
+    leg = k;
+  }
+  if(written != _knots.size()-1) write(_knots.size()-1,_omega.back());
+}
@@ -0,0 +1,153 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/TrackFusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+/*At most the common state, on the stack*/
+typedef Matrix<double,Dynamic,Dynamic,0,NUM_STATES,NUM_STATES> SubMatrix;
+typedef Matrix<double,Dynamic,1,0,NUM_STATES,1> SubVector;
+}
+
+TrackFusion::TrackFusion(double gate, int numThreads):
+        _gate(gate),
+        _numThreads(max(1,numThreads)){ }
+
+TrackFusion::Track TrackFusion::Intersect(const Track& a, const Track& b, double* weight) {
+  int shared[NUM_STATES], m = 0;
+  Track fused;
+  fused.first.setZero();
+  fused.second.setZero();
+  for(int i = 0;i<NUM_STATES;i++) {
+    bool inA = a.second(i,i) > 0, inB = b.second(i,i) > 0;
+    if(inA && inB) shared[m++] = i;
+    else if(inA || inB) {//one node's private state, its correlations with the fused ones are dropped
+      const Track& carrier = inA ? a : b;
+      fused.first(i) = carrier.first(i);
+      fused.second(i,i) = carrier.second(i,i);
+    }
+  }
+  if(m == 0) {
+    if(weight) *weight = NAN;
+    return fused;
+  }
+
+  SubMatrix Pa(m,m), Pb(m,m);
+  SubVector xa(m), xb(m);
+  for(int i = 0;i<m;i++) {
+    xa(i) = a.first(shared[i]);
+    xb(i) = b.first(shared[i]);
+    for(int j = 0;j<m;j++) {
+      Pa(i,j) = a.second(shared[i],shared[j]);
+      Pb(i,j) = b.second(shared[i],shared[j]);
+    }
+  }
+  SubMatrix A = Pa.ldlt().solve(SubMatrix::Identity(m,m)), B = Pb.ldlt().solve(SubMatrix::Identity(m,m));
+  A = .5*(A + A.transpose()).eval();
+  B = .5*(B + B.transpose()).eval();
+
+  /*d/dw log det = sum (l-1)/(1+w(l-1)), decreasing in w*/
+  GeneralizedSelfAdjointEigenSolver<SubMatrix> eigen(A,B,EigenvaluesOnly);
+  SubVector d = eigen.eigenvalues().array() - 1;
+  auto slope = [&](double w, double* curvature) {
+    double g = 0, h = 0;
+    for(int i = 0;i<m;i++) {
+      double q = d(i)/(1+w*d(i));
+      g += q;
+      h -= q*q;
+    }
+    if(curvature) *curvature = h;
+    return g;
+  };
+  double w;
+  if(slope(0,nullptr) <= 0) w = 0;
+  else if(slope(1,nullptr) >= 0) w = 1;
+  else {
+    double lo = 0, hi = 1;
+    w = .5;
+    for(int iteration = 0;iteration<50 && hi-lo > 1e-12;iteration++) {
+      double h, g = slope(w,&h);
+      if(g > 0) lo = w;
+      else hi = w;
+      double next = h < 0 ? w - g/h : .5*(lo+hi);
+      w = next > lo && next < hi ? next : .5*(lo+hi);//Newton while it stays inside the bracket
+    }
+  }
+  if(weight) *weight = w;
+
+  SubMatrix information = w*A + (1-w)*B;
+  SubMatrix P = information.ldlt().solve(SubMatrix::Identity(m,m));
+  SubVector x = P*(w*A*xa + (1-w)*B*xb);
+  for(int i = 0;i<m;i++) {
+    fused.first(shared[i]) = x(i);
+    for(int j = 0;j<m;j++) fused.second(shared[i],shared[j]) = .5*(P(i,j)+P(j,i));
+  }
+  return fused;
+}
+
+double TrackFusion::Distance(const Track& a, const Track& b) {
+  Vector4d v;
+  Matrix4d S;
+  for(int i = 0;i<4;i++) {
+    v(i) = a.first(i) - b.first(i);
+    for(int j = 0;j<4;j++) S(i,j) = a.second(i,j) + b.second(i,j);
+  }
+  return v.dot(S.ldlt().solve(v));
+}
+
+vector<pair<int,int>> TrackFusion::Associate(const vector<Track>& a, const vector<Track>& b) const {
+  vector<pair<double,pair<int,int>>> candidates;
+  for(size_t i = 0;i<a.size();i++) {
+    for(size_t j = 0;j<b.size();j++) {
+      double d2 = Distance(a[i],b[j]);
+      if(d2 <= _gate) candidates.push_back(make_pair(d2,make_pair(int(i),int(j))));
+    }
+  }
+  sort(candidates.begin(),candidates.end());
+  vector<bool> usedA(a.size(),false), usedB(b.size(),false);
+  vector<pair<int,int>> pairs;
+  for(auto& candidate:candidates) {
+    int i = candidate.second.first, j = candidate.second.second;
+    if(usedA[i] || usedB[j]) continue;
+    usedA[i] = usedB[j] = true;
+    pairs.push_back(candidate.second);
+  }
+  return pairs;
+}
+
+void TrackFusion::IntersectBatch(const vector<Track>& a, const vector<Track>& b, const vector<pair<int,int>>& pairs,
+                                 vector<Track>& fused) const {
+  fused.resize(pairs.size());
+  int numThreads = int(min<size_t>(_numThreads,pairs.size()));
+  auto chunk = [&](int c) {
+    size_t begin = pairs.size()*c/numThreads, end = pairs.size()*(c+1)/numThreads;
+    for(size_t k = begin;k<end;k++) fused[k] = Intersect(a[pairs[k].first],b[pairs[k].second]);
+  };
+  vector<thread> workers;
+  for(int c = 1;c<numThreads;c++) workers.push_back(thread(chunk,c));
+  if(numThreads > 0) chunk(0);
+  for(auto& worker:workers) worker.join();
+}
+
+vector<TrackFusion::Track> TrackFusion::Fuse(const vector<vector<Track>>& nodes) const {
+  if(nodes.empty()) return vector<Track>();
+  vector<Track> system = nodes[0], fused;
+  for(size_t n = 1;n<nodes.size();n++) {
+    const vector<Track>& local = nodes[n];
+    vector<pair<int,int>> pairs = Associate(system,local);
+    IntersectBatch(system,local,pairs,fused);
+    vector<bool> matched(local.size(),false);
+    for(size_t k = 0;k<pairs.size();k++) {
+      system[pairs[k].first] = fused[k];
+      matched[pairs[k].second] = true;
+    }
+    for(size_t j = 0;j<local.size();j++) if(!matched[j]) system.push_back(local[j]);
+  }
+  return system;
+}
@@ -0,0 +1,219 @@
+//
+// Created by clancy on 5/11/16.
+//
+
+#include "../include/TrackingService.h"
+#include "../include/IMM.h"
+#include "../include/MotionModels.h"
+#include "../include/QuantileSketch.h"
+#include "../include/Target.h"
+#include "../include/RangeSensor.h"
+#include "../include/AzimuthSensor.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/*Power of two buckets in ns for the shape, a sketch for the percentiles*/
+class LatencyHistogram {
+  array<uint64_t,40> _buckets;
+  QuantileSketch _sketch;
+  double _sum = 0, _max = 0;
+
+  public:
+  LatencyHistogram() { _buckets.fill(0); }
+
+  void Add(double seconds) {
+    double ns = seconds*1e9;
+    int bucket = ns < 1 ? 0 : min(int(_buckets.size())-1,int(log2(ns)));
+    _buckets[bucket]++;
+    _sketch.Add(ns);
+    _sum += ns;
+    _max = max(_max,ns);
+  }
+
+  void Report(ostream& os, const string& title) {
+    if(_sketch.Count() == 0) return;
+    os<<title<<": "<<_sketch.Count()<<" updates, mean "<<_sum/_sketch.Count()<<" ns, p50 "<<_sketch.Quantile(.5)
+      <<" ns, p99 "<<_sketch.Quantile(.99)<<" ns, p99.9 "<<_sketch.Quantile(.999)<<" ns, max "<<_max<<" ns"<<endl;
+    for(size_t i = 0;i<_buckets.size();i++) {
+      if(_buckets[i] == 0) continue;
+      os<<"  ["<<setw(10)<<(i ? uint64_t(1)<<i : 0)<<", "<<setw(10)<<(uint64_t(1)<<(i+1))<<") ns "<<_buckets[i]<<endl;
+    }
+  }
+};
+
+/*read() and write() may move less than asked for, on pipes and sockets alike*/
+bool ReadFully(int fd, void* data, size_t size) {
+  char* p = static_cast<char*>(data);
+  while(size > 0) {
+    ssize_t n = read(fd,p,size);
+    if(n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const void* data, size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while(size > 0) {
+    ssize_t n = write(fd,p,size);
+    if(n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+void FillFrame(EstimateFrame& frame, const pair<StateVector,StateCovarianceMatrix>& estimate) {
+  int k = 0;
+  for(int i = 0;i<NUM_STATES;i++) {
+    frame.x[i] = estimate.first(i);
+    for(int j = i;j<NUM_STATES;j++) frame.P[k++] = estimate.second(i,j);
+  }
+}
+
+/*One track per connection. The filters are built before the first frame is read so nothing is set up on the clock*/
+void ServeConnection(const StudyConfiguration& config, int in, int out, LatencyHistogram& histogram) {
+  auto kf1 = setupCVKalmanFilter(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,config.seed);
+  auto ekf1 = setupCTExtendedKalmanFilter(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,config.seed);
+  unique_ptr<IMM<>> immCT;
+  MeasurementVector z0;
+  double lastTime = NAN;
+  MeasurementFrame measurement;
+  EstimateFrame reply;
+  for(int n = 0;ReadFully(in,&measurement,sizeof(measurement));n++) {
+    Clock::time_point start = Clock::now();
+    MeasurementVector z;
+    z << measurement.range, measurement.azimuth;
+    reply.time = measurement.time;
+    if(n == 0) {
+      z0 = z;
+      fill(begin(reply.x),end(reply.x),NAN);
+      fill(begin(reply.P),end(reply.P),NAN);
+      reply.MOD2PR = NAN;
+    }
+    else if(n == 1) {
+      kf1.Initialize(z0,z);
+      ekf1.Initialize(z0,z);
+      immCT.reset(new IMM<>(kf1,ekf1));
+      FillFrame(reply,kf1.GetEstimate());
+      reply.MOD2PR = immCT->GetMOD2PR();
+    }
+    else {
+      int gap = int(lround((measurement.time-lastTime)/config.Ts));//in scans, 1 without a missed detection
+      if(gap > 1) immCT->Coast(gap-1);
+      FillFrame(reply,immCT->Update(z));
+      reply.MOD2PR = immCT->GetMOD2PR();
+    }
+    lastTime = measurement.time;
+    reply.latency = chrono::duration<double>(Clock::now()-start).count();
+    if(n > 1) histogram.Add(reply.latency);//initialization isn't a steady state update
+    if(!WriteFully(out,&reply,sizeof(reply))) return;
+  }
+}
+
+sockaddr_un SocketAddress(const string& socketPath) {
+  sockaddr_un address;
+  memset(&address,0,sizeof(address));
+  address.sun_family = AF_UNIX;
+  if(socketPath.size() >= sizeof(address.sun_path)) throw runtime_error("socket path too long: " + socketPath);
+  strncpy(address.sun_path,socketPath.c_str(),sizeof(address.sun_path)-1);
+  return address;
+}
+}
+
+int ServeMeasurements(const StudyConfiguration& config, string socketPath) {
+  signal(SIGPIPE,SIG_IGN);//a client leaving early ends its track, not the service
+  if(socketPath.empty()) {
+    LatencyHistogram histogram;
+    ServeConnection(config,STDIN_FILENO,STDOUT_FILENO,histogram);
+    histogram.Report(cerr,"update latency");
+    return 0;
+  }
+  sockaddr_un address = SocketAddress(socketPath);
+  int listener = socket(AF_UNIX,SOCK_STREAM,0);
+  unlink(socketPath.c_str());
+  if(listener < 0 || ::bind(listener,(sockaddr*)&address,sizeof(address)) != 0 || listen(listener,1) != 0) {
+    cerr<<"could not listen on "<<socketPath<<": "<<strerror(errno)<<endl;
+    return 1;
+  }
+  cerr<<"listening on "<<socketPath<<endl;
+  while(true) {
+    int client = accept(listener,nullptr,nullptr);
+    if(client < 0) continue;
+    LatencyHistogram histogram;
+    ServeConnection(config,client,client,histogram);
+    close(client);
+    histogram.Report(cerr,"update latency");
+  }
+}
+
+int ReplayMeasurements(const StudyConfiguration& config, string socketPath) {
+  /*Same streams as trial 0 of the Monte Carlo study*/
+  array<uint32_t,6> streamSeeds = TrialStreamSeeds(config.seed,0);
+  RangeSensor range(config.sensorState,0,config.sigmaR);
+  AzimuthSensor azimuth(config.sensorState,0,config.sigmaTheta);
+  range.Seed(streamSeeds[0]);
+  azimuth.Seed(streamSeeds[1]);
+  seed_seq missSeeds{config.seed,0u,3u};
+  uint32_t missSeed;
+  missSeeds.generate(&missSeed,&missSeed+1);
+  mt19937 missGenerator(missSeed);
+  bernoulli_distribution missed(config.missProbability);
+  Target target(config.trajectoryFile);
+  vector<MeasurementFrame> frames;
+  for(int i = 0;i<NUM_SAMPLES+1;i++) {
+    MeasurementFrame frame;
+    frame.time = i*config.Ts;
+    frame.range = range.Measure(target);
+    frame.azimuth = azimuth.Measure(target);
+    bool dropped = i >= 2 && config.missProbability > 0 && missed(missGenerator);//the study's misses
+    if(!dropped) frames.push_back(frame);
+    target.Advance(config.samplesPerStep);
+  }
+
+  if(socketPath == "-") {
+    for(auto& frame:frames) if(!WriteFully(STDOUT_FILENO,&frame,sizeof(frame))) return 1;
+    return 0;
+  }
+  sockaddr_un address = SocketAddress(socketPath);
+  int server = socket(AF_UNIX,SOCK_STREAM,0);
+  if(server < 0 || connect(server,(sockaddr*)&address,sizeof(address)) != 0) {
+    cerr<<"could not connect to "<<socketPath<<": "<<strerror(errno)<<endl;
+    return 1;
+  }
+  LatencyHistogram roundTrip, service;
+  IOFormat myFormat(StreamPrecision, 0, ", ", ",", "", "", "", "");
+  for(size_t n = 0;n<frames.size();n++) {
+    auto& frame = frames[n];
+    EstimateFrame reply;
+    Clock::time_point start = Clock::now();
+    if(!WriteFully(server,&frame,sizeof(frame)) || !ReadFully(server,&reply,sizeof(reply))) {
+      cerr<<"service closed the connection"<<endl;
+      close(server);
+      return 1;
+    }
+    double elapsed = chrono::duration<double>(Clock::now()-start).count();
+    if(n < 2) continue;//track initialization
+    roundTrip.Add(elapsed);
+    service.Add(reply.latency);
+    cout<<reply.time<<", "<<Map<StateVector>(reply.x).format(myFormat)<<", "<<reply.MOD2PR<<endl;
+  }
+  close(server);
+  service.Report(cerr,"service latency");
+  roundTrip.Report(cerr,"round trip latency");
+  return 0;
+}
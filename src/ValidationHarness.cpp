@@ -0,0 +1,157 @@
+//
+// Created by clancy on 5/17/16.
+//
+
+#include "../include/ValidationHarness.h"
+#include "../include/IMM.h"
+#include "../include/MotionModels.h"
+#include "../include/PerformanceEvaluator.h"
+#include "../include/Target.h"
+#include "../include/RangeSensor.h"
+#include "../include/AzimuthSensor.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+const char* quantityNames[] = {"x","xDot","y","yDot","omega","POS","NEES","MOD2PR"};
+const int numQuantities = NUM_STATES+3;
+
+/*The study's bank, pooled: reseeded and initialized for every trial*/
+template<class PrecisionPolicy>
+struct Bank {
+  CVKalmanFilter<PrecisionPolicy> kf2;
+  IMM<PrecisionPolicy> immCT, immL;
+
+  /*the same model on the dense kernel*/
+  template<class Filter>
+  static Filter OnKernel(const Filter& filter, bool dense) {
+    if(!dense) return filter;
+    auto model = make_shared<typename Filter::Model>(*filter.GetModel());
+    model->structure = CovarianceStructure::Dense;
+    return Filter(model,0);
+  }
+
+  Bank(const StudyConfiguration& config, bool dense):
+          kf2(OnKernel(setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0),dense)),
+          immCT(OnKernel(setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),dense),
+                OnKernel(setupCTExtendedKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V3,config.sigmaR,config.sigmaTheta,0),dense)),
+          immL(OnKernel(setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V1,config.sigmaR,config.sigmaTheta,0),dense),
+               OnKernel(setupCVKalmanFilter<PrecisionPolicy>(config.sensorState,config.Ts,config.V2,config.sigmaR,config.sigmaTheta,0),dense)){}
+
+  void Start(const array<uint32_t,6>& seeds, const ConvertedMeasurement& z0, const ConvertedMeasurement& z1) {
+    kf2.Reset(seeds[3]);
+    immCT.Reset({seeds[2],seeds[4]});
+    immL.Reset({seeds[2],seeds[3]});
+    kf2.Initialize(z0,z1);
+    immCT.Initialize(z0,z1);
+    immL.Initialize(z0,z1);
+  }
+
+  /*every filter's quantities after the update, in double*/
+  void Update(const ConvertedMeasurement& z, StateVector truth, double quantities[3][numQuantities]) {
+    auto record = [&](double* q, const StateVector& x, const StateCovarianceMatrix& P, double mode) {
+      StateVector xEst = x;
+      StateCovarianceMatrix PEst = P;
+      for(int c = 0;c<NUM_STATES;c++) q[c] = xEst(c);
+      q[NUM_STATES] = PerformanceEvaluator::CalculatePOS(xEst,PEst,truth);
+      q[NUM_STATES+1] = PerformanceEvaluator::CalculateNEES(xEst,PEst,truth);
+      q[NUM_STATES+2] = mode;
+    };
+    auto kf = kf2.Update(z);
+    auto ct = immCT.Update(z);
+    auto l = immL.Update(z);
+    record(quantities[0],kf.first.template cast<DataType>(),kf.second.template cast<DataType>(),0);
+    record(quantities[1],ct.first.template cast<DataType>(),ct.second.template cast<DataType>(),immCT.GetMOD2PR());
+    record(quantities[2],l.first.template cast<DataType>(),l.second.template cast<DataType>(),immL.GetMOD2PR());
+  }
+};
+
+struct Deviation {
+  double maxAbs = 0, maxRel = 0;
+  bool diverged = false;
+};
+
+struct Divergence {
+  int trial = -1, step = 0, filter = 0, quantity = 0;
+  double reference = 0, fast = 0;
+};
+
+template<class PrecisionPolicy>
+int Validate(const StudyConfiguration& config, const string& path, double stateTolerance, double metricTolerance) {
+  Bank<DoublePrecision> reference(config,true);
+  Bank<PrecisionPolicy> fast(config,false);
+  RangeSensor range(config.sensorState,0,config.sigmaR);
+  AzimuthSensor azimuth(config.sensorState,0,config.sigmaTheta);
+  MeasurementConverter converter(config.sensorState,config.sigmaR,config.sigmaTheta);
+  const char* filterNames[] = {"kf","immCT","immL"};
+  Deviation deviations[3][numQuantities];
+  Divergence first;
+
+  for(int trial = config.firstTrial;trial<config.firstTrial+config.numTrials;trial++) {
+    /*the study's streams for this trial*/
+    array<uint32_t,6> streamSeeds = TrialStreamSeeds(config.seed,unsigned(trial));
+    range.Seed(streamSeeds[0]);
+    azimuth.Seed(streamSeeds[1]);
+    Target target(config.trajectoryFile);
+    vector<MeasurementVector> z;
+    vector<StateVector> truth;
+    for(int i = 0;i<NUM_SAMPLES+1;i++) {
+      MeasurementVector zi;
+      zi(0) = range.Measure(target);
+      zi(1) = azimuth.Measure(target);
+      z.push_back(zi);
+      truth.push_back(target.Sample());
+      target.Advance(config.samplesPerStep);
+    }
+    vector<ConvertedMeasurement> converted = converter.ConvertBatch(z);
+    reference.Start(streamSeeds,converted[0],converted[1]);
+    fast.Start(streamSeeds,converted[0],converted[1]);
+
+    for(size_t i = 2;i<converted.size();i++) {
+      double ref[3][numQuantities], val[3][numQuantities];
+      reference.Update(converted[i],truth[i],ref);
+      fast.Update(converted[i],truth[i],val);
+      for(int f = 0;f<3;f++) {
+        for(int q = 0;q<numQuantities;q++) {
+          double diff = abs(val[f][q]-ref[f][q]), tolerance = q < NUM_STATES ? stateTolerance : metricTolerance;
+          Deviation& d = deviations[f][q];
+          d.maxAbs = max(d.maxAbs,diff);
+          d.maxRel = max(d.maxRel,diff/(1+abs(ref[f][q])));
+          if(!(diff <= tolerance*(1+abs(ref[f][q])))) {//NaNs diverge too
+            d.diverged = true;
+            if(first.trial < 0) first = {trial,int(i),f,q,ref[f][q],val[f][q]};
+          }
+        }
+      }
+    }
+  }
+
+  cout<<"fast path "<<path<<" against the dense double precision reference over "<<config.numTrials
+      <<" trials, tolerances "<<stateTolerance<<" (state) and "<<metricTolerance<<" (metrics)"<<endl;
+  cout<<setw(6)<<"filter"<<setw(8)<<"value"<<setw(14)<<"max abs"<<setw(14)<<"max rel"<<endl;
+  for(int f = 0;f<3;f++) {
+    for(int q = 0;q<numQuantities;q++) {
+      const Deviation& d = deviations[f][q];
+      cout<<setw(6)<<filterNames[f]<<setw(8)<<quantityNames[q]<<setw(14)<<d.maxAbs<<setw(14)<<d.maxRel
+          <<(d.diverged ? "   EXCEEDED" : "   ok")<<endl;
+    }
+  }
+  if(first.trial < 0) {
+    cout<<"no divergence"<<endl;
+    return 0;
+  }
+  cout<<setprecision(17)<<"first divergence: trial "<<first.trial<<", step "<<first.step<<", "<<filterNames[first.filter]
+      <<" "<<quantityNames[first.quantity]<<", reference "<<first.reference<<", fast "<<first.fast<<endl;
+  return 1;
+}
+
+}
+
+int ValidateFastPath(const StudyConfiguration& config, const string& path, double stateTolerance, double metricTolerance) {
+  if(path == "structured") return Validate<DoublePrecision>(config,path,stateTolerance,metricTolerance);
+  if(path == "single") return Validate<SinglePrecision>(config,path,stateTolerance,metricTolerance);
+  if(path == "mixed") return Validate<MixedPrecision>(config,path,stateTolerance,metricTolerance);
+  throw invalid_argument("no fast path "+path+", give structured, single or mixed");
+}